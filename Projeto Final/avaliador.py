@@ -1,4 +1,10 @@
+import argparse
+import csv
+import glob
+import json
 import os
+import platform
+import random
 import subprocess
 import statistics
 import shutil
@@ -15,37 +21,158 @@ PARAMS = {
     "I_ITERATIONS": 50,
 }
 
-# Número de vezes que cada executável será rodado para tirar a média
+# Número de execuções medidas de cada executável
 NUM_RUNS = 30
 
+# Execuções de aquecimento (descartadas) antes das medidas: aquecem cache de
+# páginas do dataset, frequência da CPU e alocador
+NUM_WARMUP = 3
+
+# Reamostragens bootstrap e nível de confiança dos intervalos de speedup
+BOOTSTRAP_RESAMPLES = 10000
+CONFIDENCE = 0.95
+
+# Na comparação com um resultado anterior (--compare), variações da mediana
+# menores que isso não contam como regressão, mesmo que significativas
+REGRESSION_THRESHOLD = 0.02
+
+# Diretório onde os resultados brutos (JSON e CSV) são gravados
+RESULTS_DIR = "resultados"
+
 # Detecta o número de núcleos de CPU disponíveis para usar nos testes paralelos
+# (recalculado em main() quando os núcleos são restringidos com --cpus)
 CPU_CORES = os.cpu_count() or 4 # Usa 4 como padrão se a detecção falhar
 
+# Versão híbrida (MPI + OpenMP): processos x threads. Por padrão, um processo por nó NUMA
+# e os núcleos divididos igualmente entre eles; pode ser sobrescrito com HYBRID_RANKS/HYBRID_THREADS.
+NUMA_NODES = len(glob.glob("/sys/devices/system/node/node[0-9]*")) or 1
+HYBRID_RANKS = int(os.environ.get("HYBRID_RANKS", NUMA_NODES))
+HYBRID_THREADS = int(os.environ.get("HYBRID_THREADS", max(1, CPU_CORES // HYBRID_RANKS)))
+
 # Lista de executáveis a serem testados
 EXECUTABLES = [
-    {"name": "Sequencial", "source": "kmeans_sequencial.c", "output": "kmeans_sequencial", "type": "serial", "compile_cmd": "gcc -o kmeans_sequencial kmeans_sequencial.c -O3"},
+    {"name": "Sequencial", "source": "kmeans_sequencial.c", "output": "kmeans_sequencial", "type": "serial", "compile_cmd": "gcc -o kmeans_sequencial kmeans_sequencial.c -O3 -lm -pthread"},
     {"name": "OpenMP", "source": "kmeans_openmp.c", "output": "kmeans_openmp", "type": "omp", "compile_cmd": "gcc -o kmeans_openmp kmeans_openmp.c -fopenmp -O3"},
-    {"name": "Pthreads", "source": "kmeans_pthreads.c", "output": "kmeans_pthreads", "type": "serial", "compile_cmd": "gcc -o kmeans_pthreads kmeans_pthreads.c -lpthread -O3"},
-    {"name": "MPI", "source": "kmeans_mpi.c", "output": "kmeans_mpi", "type": "mpi", "compile_cmd": "mpicc -o kmeans_mpi kmeans_mpi.c -O3"}
+    {"name": "Pthreads", "source": "kmeans_pthreads.c", "output": "kmeans_pthreads", "type": "pthreads", "compile_cmd": "gcc -o kmeans_pthreads kmeans_pthreads.c -lpthread -O3"},
+    {"name": "MPI", "source": "kmeans_mpi.c", "output": "kmeans_mpi", "type": "mpi", "compile_cmd": "mpicc -o kmeans_mpi kmeans_mpi.c -O3"},
+    {"name": "Híbrido", "source": "kmeans_mpi.c", "output": "kmeans_hibrido", "type": "hybrid", "compile_cmd": "mpicc -o kmeans_hibrido kmeans_mpi.c -fopenmp -O3"}
 ]
 
 # --- Cores para o Terminal ---
 class C:
     HEADER = '\033[95m'; BLUE = '\033[94m'; GREEN = '\033[92m'; YELLOW = '\033[93m'; RED = '\033[91m'; END = '\033[0m'; BOLD = '\033[1m'
 
+# --- Estatística ---
+
+def percentile(values, q):
+    """Percentil q (0..100) com interpolação linear entre as amostras ordenadas."""
+    ordered = sorted(values)
+    if not ordered: return 0.0
+    pos = (len(ordered) - 1) * q / 100.0
+    lo = int(pos); hi = min(lo + 1, len(ordered) - 1)
+    return ordered[lo] + (ordered[hi] - ordered[lo]) * (pos - lo)
+
+def find_outliers(values):
+    """Índices das amostras fora das cercas de Tukey (1,5 x IQR além dos quartis)."""
+    if len(values) < 4: return []
+    q1, q3 = percentile(values, 25), percentile(values, 75)
+    low, high = q1 - 1.5 * (q3 - q1), q3 + 1.5 * (q3 - q1)
+    return [i for i, v in enumerate(values) if v < low or v > high]
+
+def summarize(times):
+    """Estatísticas robustas de uma série de tempos. Outliers são só sinalizados:
+    a mediana e os percentis já são pouco sensíveis a eles, e as amostras brutas
+    ficam todas no JSON/CSV."""
+    if not times: return None
+    median = statistics.median(times)
+    return {
+        "n": len(times),
+        "median": median,
+        "p5": percentile(times, 5),
+        "p95": percentile(times, 95),
+        "mean": statistics.mean(times),
+        "stdev": statistics.stdev(times) if len(times) > 1 else 0.0,
+        "mad": statistics.median([abs(t - median) for t in times]),
+        "min": min(times),
+        "max": max(times),
+        "outliers": find_outliers(times),
+    }
+
+def bootstrap_ratio_ci(numerator, denominator, rng, resamples=BOOTSTRAP_RESAMPLES, confidence=CONFIDENCE):
+    """Intervalo de confiança (bootstrap por percentis) de median(numerator) / median(denominator).
+    As duas séries são reamostradas de forma independente, com reposição."""
+    if not numerator or not denominator: return (0.0, 0.0)
+    ratios = []
+    for _ in range(resamples):
+        num = statistics.median(rng.choices(numerator, k=len(numerator)))
+        den = statistics.median(rng.choices(denominator, k=len(denominator)))
+        ratios.append(num / den if den > 0 else 0.0)
+    alpha = (1.0 - confidence) / 2.0
+    return (percentile(ratios, 100 * alpha), percentile(ratios, 100 * (1 - alpha)))
+
+# --- Isolamento da Máquina ---
+
+def parse_cpu_list(text):
+    """Converte uma lista de CPUs no formato do kernel ("0-3,8,10-11") em uma lista de inteiros."""
+    cpus = []
+    for part in text.split(','):
+        part = part.strip()
+        if not part: continue
+        if '-' in part:
+            first, last = part.split('-'); cpus.extend(range(int(first), int(last) + 1))
+        else:
+            cpus.append(int(part))
+    return sorted(set(cpus))
+
+def read_sys(path):
+    """Conteúdo de um arquivo do /sys ou /proc, ou None se não existir."""
+    try:
+        with open(path) as f: return f.read().strip()
+    except OSError:
+        return None
+
+def check_isolation(cpus):
+    """Coleta o estado da máquina que afeta as medidas e imprime avisos quando ele
+    compromete a repetibilidade (núcleos não isolados, governador que varia a
+    frequência, carga de outros processos)."""
+    print(f"{C.HEADER}--- Verificando Isolamento ---{C.END}")
+    isolated = parse_cpu_list(read_sys("/sys/devices/system/cpu/isolated") or "")
+    governors = sorted({read_sys(f"/sys/devices/system/cpu/cpu{c}/cpufreq/scaling_governor") or "desconhecido" for c in cpus})
+    no_turbo = read_sys("/sys/devices/system/cpu/intel_pstate/no_turbo")
+    load = os.getloadavg()[0] if hasattr(os, "getloadavg") else 0.0
+    info = {"cpus": cpus, "isolated": isolated, "governors": governors, "no_turbo": no_turbo, "loadavg_1min": load}
+
+    print(f"Núcleos usados: {','.join(map(str, cpus))}")
+    warnings = []
+    if not set(cpus) <= set(isolated):
+        warnings.append("núcleos não isolados (boot com isolcpus=/nohz_full= ou use um cpuset dedicado)")
+    if governors != ["performance"]:
+        warnings.append(f"governador de frequência '{','.join(governors)}' (prefira 'performance')")
+    if no_turbo == "0":
+        warnings.append("turbo boost ligado (a frequência varia com a temperatura e a carga)")
+    if load > 0.5:
+        warnings.append(f"carga média de {load:.2f} no último minuto (há outros processos rodando)")
+    for w in warnings: print(f"{C.YELLOW}Aviso: {w}.{C.END}")
+    if not warnings: print(f"{C.GREEN}Máquina isolada para o benchmark.{C.END}")
+    print()
+    return info
+
 # --- Funções do Avaliador ---
 
-def check_dependencies():
+def check_dependencies(executables):
     """Verifica se os compiladores necessários estão instalados."""
     print(f"{C.HEADER}--- Verificando Dependências ---{C.END}")
     if not shutil.which("gcc"): print(f"{C.RED}Erro: Compilador 'gcc' não encontrado.{C.END}"); exit(1)
-    if not shutil.which("mpicc"): print(f"{C.RED}Erro: Compilador 'mpicc' não encontrado.{C.END}"); exit(1)
-    print(f"{C.GREEN}Compiladores 'gcc' e 'mpicc' encontrados.{C.END}\n")
+    if any(e['type'] in ('mpi', 'hybrid') for e in executables):
+        if not shutil.which("mpicc"): print(f"{C.RED}Erro: Compilador 'mpicc' não encontrado.{C.END}"); exit(1)
+        print(f"{C.GREEN}Compiladores 'gcc' e 'mpicc' encontrados.{C.END}\n")
+    else:
+        print(f"{C.GREEN}Compilador 'gcc' encontrado.{C.END}\n")
 
-def compile_sources():
-    """Compila todos os arquivos fonte C definidos na lista EXECUTABLES."""
+def compile_sources(executables):
+    """Compila todos os arquivos fonte C da lista de executáveis."""
     print(f"{C.HEADER}--- Compilando Códigos Fonte ---{C.END}")
-    for exe in EXECUTABLES:
+    for exe in executables:
         print(f"Compilando {C.YELLOW}{exe['name']}{C.END} ({exe['source']})... ", end='', flush=True)
         try:
             subprocess.run(exe['compile_cmd'], shell=True, check=True, capture_output=True, text=True)
@@ -62,75 +189,246 @@ def get_golden_checksum(args):
         # Passa os argumentos para a chamada
         cmd = [f"./{seq_exe['output']}"] + args
         result = subprocess.run(cmd, capture_output=True, text=True, check=True)
-        _, checksum_str = result.stdout.strip().split('\n')
+        # Só as duas primeiras linhas: métricas opcionais podem vir depois
+        _, checksum_str = result.stdout.strip().split('\n')[:2]
         golden_checksum = int(checksum_str)
         print(f"{C.GREEN}Checksum de referência obtido: {golden_checksum}{C.END}\n")
         return golden_checksum
     except (subprocess.CalledProcessError, StopIteration, ValueError, IndexError) as e:
         print(f"{C.RED}Erro ao obter o checksum de referência: {e}{C.END}"); exit(1)
 
-def run_benchmark(golden_checksum, args):
-    """Executa cada programa, coleta os tempos e verifica os checksums."""
-    results = []
+def build_command(exe, args, seq_args):
+    """Monta o comando e o ambiente de execução de um executável."""
+    base_cmd = [f"./{exe['output']}"] + args
+    run_env = os.environ.copy()
+    if exe['name'] == 'Sequencial': base_cmd += seq_args
+    if exe['type'] == 'omp': run_env['OMP_NUM_THREADS'] = str(CPU_CORES)
+    # Número explícito de threads: o padrão do programa é o total de núcleos da máquina, não os permitidos
+    elif exe['type'] == 'pthreads': base_cmd.append(str(CPU_CORES))
+    elif exe['type'] == 'mpi': base_cmd = ["mpirun", "-np", str(CPU_CORES)] + base_cmd
+    elif exe['type'] == 'hybrid':
+        # Cada processo preso ao seu nó NUMA; as threads OpenMP ficam em núcleos vizinhos
+        run_env.update({"OMP_NUM_THREADS": str(HYBRID_THREADS), "OMP_PROC_BIND": "close", "OMP_PLACES": "cores"})
+        base_cmd = ["mpirun", "-np", str(HYBRID_RANKS), "--map-by", "numa", "--bind-to", "numa"] + base_cmd
+    return base_cmd, run_env
+
+def run_once(cmd, env):
+    """Executa o programa uma vez e devolve (tempo, checksum), ou None se falhar."""
+    try:
+        result = subprocess.run(cmd, env=env, capture_output=True, text=True, check=True)
+        time_str, checksum_str = result.stdout.strip().split('\n')[:2]
+        return float(time_str), int(checksum_str)
+    except (subprocess.CalledProcessError, ValueError, IndexError):
+        return None
+
+def check_team_limits(golden_checksum, args, executables, seq_args):
+    """Roda as versões OpenMP/híbrida com OMP_THREAD_LIMIT menor que o pedido.
+
+    O runtime pode entregar uma equipe menor que OMP_NUM_THREADS (limite ou
+    OMP_DYNAMIC); o checksum tem de continuar igual ao de referência.
+    Devolve o número de versões que falharam."""
+    failures = 0
+    for exe in executables:
+        if exe['type'] not in ('omp', 'hybrid'): continue
+        cmd, env = build_command(exe, args, seq_args)
+        requested = int(env.get("OMP_NUM_THREADS", CPU_CORES))
+        env["OMP_THREAD_LIMIT"] = str(max(1, requested // 2))
+        run = run_once(cmd, env)
+        ok = run is not None and run[1] == golden_checksum
+        failures += not ok
+        print(f"  Equipe reduzida {exe['name']:<12} (OMP_THREAD_LIMIT={env['OMP_THREAD_LIMIT']}): "
+              f"{C.GREEN + 'OK' if ok else C.RED + 'FALHOU'}{C.END}")
+    return failures
+
+def run_benchmark(golden_checksum, args, executables, num_runs, num_warmup, seq_args):
+    """Executa os programas, coleta os tempos e verifica os checksums.
+
+    As execuções medidas são intercaladas em rodadas (cada rodada roda todas as
+    versões uma vez, em ordem rotacionada): uma perturbação passageira da
+    máquina atinge todas as versões por igual, em vez de distorcer só a que
+    estava rodando naquele momento."""
     print(f"{C.HEADER}--- Iniciando Benchmark (Hardware: {CPU_CORES} núcleos) ---{C.END}")
-    
-    for exe in EXECUTABLES:
-        print(f"{C.BLUE}Avaliando: {C.BOLD}{exe['name']}{C.END}")
-        times, correct_runs = [], 0
-        
-        # Passa os argumentos para o comando base
-        base_cmd = [f"./{exe['output']}"] + args
-        run_env = os.environ.copy()
-        if exe['type'] == 'omp': run_env['OMP_NUM_THREADS'] = str(CPU_CORES)
-        elif exe['type'] == 'mpi': base_cmd = ["mpirun", "-np", str(CPU_CORES)] + base_cmd
-            
-        for i in range(NUM_RUNS):
-            print(f"  Execução {i + 1}/{NUM_RUNS}... ", end='', flush=True)
-            try:
-                result = subprocess.run(base_cmd, env=run_env, capture_output=True, text=True, check=True)
-                time_str, checksum_str = result.stdout.strip().split('\n')
-                duration, checksum = float(time_str), int(checksum_str)
-                times.append(duration)
-                if checksum == golden_checksum: correct_runs += 1
-                print(f"Tempo: {duration:.4f}s, Checksum: {'OK' if checksum == golden_checksum else 'FALHOU'}")
-            except (subprocess.CalledProcessError, ValueError, IndexError):
+    commands, results = {}, {}
+    for exe in executables:
+        commands[exe['name']] = build_command(exe, args, seq_args)
+        results[exe['name']] = {"name": exe['name'], "command": commands[exe['name']][0], "warmup": [], "samples": [], "failures": 0}
+        if exe['type'] == 'hybrid':
+            print(f"  Configuração {exe['name']}: {HYBRID_RANKS} processo(s) x {HYBRID_THREADS} thread(s)")
+
+    for exe in executables:
+        print(f"{C.BLUE}Aquecendo: {C.BOLD}{exe['name']}{C.END} ({num_warmup} execução(ões) descartadas)")
+        for _ in range(num_warmup):
+            run = run_once(*commands[exe['name']])
+            if run: results[exe['name']]['warmup'].append(run[0])
+
+    for i in range(num_runs):
+        print(f"{C.BLUE}Rodada {i + 1}/{num_runs}{C.END}")
+        shift = i % len(executables)
+        for exe in executables[shift:] + executables[:shift]:
+            print(f"  {exe['name']:<12} ", end='', flush=True)
+            run = run_once(*commands[exe['name']])
+            if run is None:
+                results[exe['name']]['failures'] += 1
                 print(f"{C.RED}FALHOU (erro na execução ou saída inválida){C.END}")
+                continue
+            duration, checksum = run
+            correct = checksum == golden_checksum
+            results[exe['name']]['samples'].append({"run": i + 1, "time": duration, "checksum": checksum, "correct": correct})
+            print(f"Tempo: {duration:.4f}s, Checksum: {'OK' if correct else 'FALHOU'}")
+    print()
+
+    return [results[exe['name']] for exe in executables]
 
-        avg_time = statistics.mean(times) if times else 0.0
-        stdev_time = statistics.stdev(times) if len(times) > 1 else 0.0
-        
-        results.append({"name": exe['name'], "avg_time": avg_time, "stdev": stdev_time, "correct_runs": correct_runs})
-        print(f"{C.GREEN}  Resultado {exe['name']}: Média = {avg_time:.4f}s, Corretude = {correct_runs}/{NUM_RUNS}{C.END}\n")
-        
+def analyze(results, num_runs, rng):
+    """Acrescenta a cada resultado as estatísticas e o speedup sobre a versão
+    sequencial (razão das medianas), com intervalo de confiança bootstrap."""
+    seq = next((r for r in results if r['name'] == 'Sequencial'), None)
+    seq_times = [s['time'] for s in seq['samples']] if seq else []
+    for res in results:
+        times = [s['time'] for s in res['samples']]
+        res['stats'] = summarize(times)
+        res['correct_runs'] = sum(1 for s in res['samples'] if s['correct'])
+        res['num_runs'] = num_runs
+        outliers = set(res['stats']['outliers']) if res['stats'] else set()
+        for idx, sample in enumerate(res['samples']): sample['outlier'] = idx in outliers
+        if res is seq:
+            res['speedup'] = {"value": 1.0, "ci_low": 1.0, "ci_high": 1.0}
+        elif seq_times and times:
+            low, high = bootstrap_ratio_ci(seq_times, times, rng)
+            res['speedup'] = {"value": statistics.median(seq_times) / res['stats']['median'], "ci_low": low, "ci_high": high}
+        else:
+            res['speedup'] = None
     return results
 
 def print_summary(results, golden_checksum):
     """Imprime uma tabela com o resumo dos resultados."""
     print(f"{C.HEADER}--- Resumo dos Resultados (Checksum de Referência: {golden_checksum}) ---{C.END}")
-    
-    try:
-        sequential_time = next(r['avg_time'] for r in results if r['name'] == 'Sequencial')
-    except StopIteration:
-        print(f"{C.RED}Erro: Versão 'Sequencial' não encontrada.{C.END}"); return
 
-    print(f"{C.BOLD}{'Versão':<15} | {'Tempo Médio (s)':<18} | {'Speedup':<12} | {'Corretude':<15}{C.END}")
-    print("-" * 65)
-    
+    if not any(r['name'] == 'Sequencial' for r in results):
+        print(f"{C.YELLOW}Aviso: versão 'Sequencial' não avaliada; speedups omitidos.{C.END}")
+
+    ci = f"IC {CONFIDENCE:.0%}"
+    print(f"{C.BOLD}{'Versão':<12} | {'Mediana (s)':<12} | {'p5 - p95 (s)':<19} | {'Speedup [' + ci + ']':<26} | {'Outliers':<8} | {'Corretude':<10}{C.END}")
+    print("-" * 102)
+
     for res in results:
-        name, avg_time = res['name'], res['avg_time']
-        speedup = sequential_time / avg_time if avg_time > 0 else 0
-        correctness = f"({res['correct_runs']}/{NUM_RUNS})"
-        status_color = C.GREEN if res['correct_runs'] == NUM_RUNS else C.RED
-        print(f"{name:<15} | {avg_time:<18.4f} | {f'{speedup:.2f}x' if name != 'Sequencial' else '1.00x':<12} | {status_color}{correctness:<15}{C.END}")
-        
-    print("-" * 65)
+        st, sp = res['stats'], res['speedup']
+        if st is None:
+            print(f"{res['name']:<12} | {C.RED}nenhuma execução válida{C.END}"); continue
+        spread = f"{st['p5']:.4f} - {st['p95']:.4f}"
+        if res['name'] == 'Sequencial': speedup = "1.00x"
+        else: speedup = f"{sp['value']:.2f}x [{sp['ci_low']:.2f}, {sp['ci_high']:.2f}]" if sp else "-"
+        outliers = f"{len(st['outliers'])}/{st['n']}"
+        correctness = f"({res['correct_runs']}/{res['num_runs']})"
+        status_color = C.GREEN if res['correct_runs'] == res['num_runs'] else C.RED
+        print(f"{res['name']:<12} | {st['median']:<12.4f} | {spread:<19} | {speedup:<26} | {outliers:<8} | {status_color}{correctness:<10}{C.END}")
+
+    print("-" * 102)
+    print()
+
+def git_revision():
+    """Commit atual do repositório (com '-dirty' se houver mudanças), ou None fora do git."""
+    try:
+        rev = subprocess.run(["git", "rev-parse", "HEAD"], capture_output=True, text=True, check=True).stdout.strip()
+        dirty = subprocess.run(["git", "status", "--porcelain", "--untracked-files=no"], capture_output=True, text=True, check=True).stdout.strip()
+        return rev + ("-dirty" if dirty else "")
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+def save_results(report, out_dir, label):
+    """Grava o relatório completo em JSON e as amostras brutas em CSV."""
+    os.makedirs(out_dir, exist_ok=True)
+    stamp = time.strftime("%Y%m%d-%H%M%S", time.localtime(report['meta']['timestamp']))
+    base = os.path.join(out_dir, f"benchmark-{stamp}" + (f"-{label}" if label else ""))
+
+    with open(base + ".json", "w") as f:
+        json.dump(report, f, indent=2, ensure_ascii=False)
+    with open(base + ".csv", "w", newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(["versao", "fase", "execucao", "tempo_s", "checksum", "correto", "outlier"])
+        for res in report['results']:
+            for i, t in enumerate(res['warmup']):
+                writer.writerow([res['name'], "aquecimento", i + 1, t, "", "", ""])
+            for s in res['samples']:
+                writer.writerow([res['name'], "medida", s['run'], s['time'], s['checksum'], int(s['correct']), int(s['outlier'])])
+
+    print(f"{C.GREEN}Resultados gravados em {base}.json e {base}.csv{C.END}\n")
+
+def compare_with(report, baseline_path, rng, threshold):
+    """Compara as medianas com um relatório anterior. Uma versão regrediu quando
+    o intervalo de confiança inteiro da razão (novo / anterior) fica acima de
+    1 + threshold, e melhorou quando fica abaixo de 1 - threshold. Devolve o
+    número de regressões."""
+    with open(baseline_path) as f: baseline = json.load(f)
+    print(f"{C.HEADER}--- Comparação com {baseline_path} ({baseline['meta'].get('git_revision') or 'revisão desconhecida'}) ---{C.END}")
+    if baseline['meta'].get('params') != report['meta']['params']:
+        print(f"{C.YELLOW}Aviso: parâmetros diferentes dos usados na referência.{C.END}")
+
+    old_by_name = {r['name']: r for r in baseline['results']}
+    print(f"{C.BOLD}{'Versão':<12} | {'Anterior (s)':<12} | {'Atual (s)':<12} | {'Razão [IC ' + f'{CONFIDENCE:.0%}' + ']':<24} | {'Veredito':<14}{C.END}")
+    print("-" * 86)
+    regressions = 0
+    for res in report['results']:
+        old = old_by_name.get(res['name'])
+        new_times = [s['time'] for s in res['samples']]
+        old_times = [s['time'] for s in old['samples']] if old else []
+        if not new_times or not old_times:
+            print(f"{res['name']:<12} | {'-':<12} | {'-':<12} | {'-':<24} | sem referência"); continue
+        old_med, new_med = statistics.median(old_times), statistics.median(new_times)
+        low, high = bootstrap_ratio_ci(new_times, old_times, rng)
+        if low > 1 + threshold:
+            verdict, color = "REGRESSÃO", C.RED; regressions += 1
+        elif high < 1 - threshold:
+            verdict, color = "melhoria", C.GREEN
+        else:
+            verdict, color = "sem mudança", ""
+        ratio = f"{new_med / old_med:.3f} [{low:.3f}, {high:.3f}]"
+        print(f"{res['name']:<12} | {old_med:<12.4f} | {new_med:<12.4f} | {ratio:<24} | {color}{verdict:<14}{C.END}")
+    print("-" * 86)
+    print()
+    return regressions
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Compila, executa e compara o desempenho das versões do K-Means.")
+    parser.add_argument("--runs", type=int, default=NUM_RUNS, help=f"execuções medidas por versão (padrão: {NUM_RUNS})")
+    parser.add_argument("--warmup", type=int, default=NUM_WARMUP, help=f"execuções de aquecimento descartadas (padrão: {NUM_WARMUP})")
+    parser.add_argument("--cpus", help="restringe o benchmark a estes núcleos, ex.: 2-7 (de preferência isolados com isolcpus=)")
+    parser.add_argument("--only", help="avalia só estas versões, separadas por vírgula (ex.: Sequencial,OpenMP)")
+    parser.add_argument("--seq-args", default="", help="opções extras para a versão sequencial, ex.: '--assign=gemm --fused'")
+    parser.add_argument("--no-compile", action="store_true", help="usa os executáveis já compilados")
+    parser.add_argument("--output-dir", default=RESULTS_DIR, help=f"diretório dos resultados JSON/CSV (padrão: {RESULTS_DIR})")
+    parser.add_argument("--label", default="", help="sufixo do nome dos arquivos de resultado (ex.: nome do motor)")
+    parser.add_argument("--compare", metavar="JSON", help="compara com um resultado anterior e termina com código 1 se houver regressão")
+    parser.add_argument("--threshold", type=float, default=REGRESSION_THRESHOLD, help=f"variação relativa tolerada na comparação (padrão: {REGRESSION_THRESHOLD})")
+    parser.add_argument("--seed", type=int, default=12345, help="semente do bootstrap")
+    return parser.parse_args()
 
 # --- Ponto de Entrada Principal ---
 
 if __name__ == "__main__":
-    check_dependencies()
-    compile_sources()
-    
+    opts = parse_args()
+    if opts.runs < 2: print(f"{C.RED}Erro: --runs deve ser pelo menos 2.{C.END}"); exit(1)
+
+    selected = EXECUTABLES
+    if opts.only:
+        names = [n.strip() for n in opts.only.split(',')]
+        unknown = [n for n in names if n not in [e['name'] for e in EXECUTABLES]]
+        if unknown: print(f"{C.RED}Erro: versões desconhecidas: {', '.join(unknown)}.{C.END}"); exit(1)
+        selected = [e for e in EXECUTABLES if e['name'] in names]
+
+    # Fixa o avaliador (e, por herança, os programas e o mpirun) nos núcleos escolhidos
+    if opts.cpus:
+        os.sched_setaffinity(0, parse_cpu_list(opts.cpus))
+    cpus = sorted(os.sched_getaffinity(0)) if hasattr(os, "sched_getaffinity") else list(range(CPU_CORES))
+    CPU_CORES = len(cpus)
+    HYBRID_THREADS = int(os.environ.get("HYBRID_THREADS", max(1, CPU_CORES // HYBRID_RANKS)))
+
+    # A versão sequencial sempre é compilada: ela fornece o checksum de referência
+    to_compile = selected if any(e['name'] == 'Sequencial' for e in selected) else EXECUTABLES[:1] + selected
+    check_dependencies(to_compile)
+    if not opts.no_compile: compile_sources(to_compile)
+    machine = check_isolation(cpus)
+
     # Monta a lista de argumentos a partir do dicionário PARAMS
     main_args = [
         PARAMS["DATASET_FILE"],
@@ -139,8 +437,39 @@ if __name__ == "__main__":
         str(PARAMS["K_CLUSTERS"]),
         str(PARAMS["I_ITERATIONS"])
     ]
-    
+    seq_args = opts.seq_args.split()
+
     # Passa os argumentos para as funções
     golden_checksum_val = get_golden_checksum(main_args)
-    benchmark_results = run_benchmark(golden_checksum_val, main_args)
-    print_summary(benchmark_results, golden_checksum_val)
\ No newline at end of file
+    team_failures = check_team_limits(golden_checksum_val, main_args, selected, seq_args)
+    benchmark_results = run_benchmark(golden_checksum_val, main_args, selected, opts.runs, opts.warmup, seq_args)
+    rng = random.Random(opts.seed)
+    analyze(benchmark_results, opts.runs, rng)
+    print_summary(benchmark_results, golden_checksum_val)
+
+    report = {
+        "meta": {
+            "timestamp": time.time(),
+            "host": platform.node(),
+            "platform": platform.platform(),
+            "git_revision": git_revision(),
+            "params": PARAMS,
+            "seq_args": seq_args,
+            "runs": opts.runs,
+            "warmup": opts.warmup,
+            "bootstrap_resamples": BOOTSTRAP_RESAMPLES,
+            "confidence": CONFIDENCE,
+            "seed": opts.seed,
+            "golden_checksum": golden_checksum_val,
+            "team_limit_failures": team_failures,
+            "machine": machine,
+            "compile_cmds": {e['name']: e['compile_cmd'] for e in selected},
+        },
+        "results": benchmark_results,
+    }
+    save_results(report, opts.output_dir, opts.label)
+
+    if opts.compare and compare_with(report, opts.compare, rng, opts.threshold) > 0:
+        exit(1)
+    if team_failures > 0:
+        exit(1)
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "kmeans_dataset.h"  // Formato binário .kmb
+
+/**
+ * @brief Converte um dataset no formato texto (gerador_dataset.c) para o formato
+ * binário .kmb, lido com mmap pelas versões do K-Means.
+ *
+ * O arquivo texto é lido com fscanf, com o mesmo tratamento de erro das versões
+ * do K-Means, e gravado ponto a ponto, sem carregar o dataset inteiro na memória.
+ */
+int main(int argc, char* argv[]) {
+  if (argc != 5) {
+    fprintf(stderr, "Uso: %s <arquivo_texto> <num_pontos> <num_dimensoes> <arquivo_saida.kmb>\n", argv[0]);
+    fprintf(stderr, "Exemplo: %s dataset.txt 1000000 10 dataset.kmb\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char* input_filename = argv[1];
+  int num_points = atoi(argv[2]);
+  int num_dimensions = atoi(argv[3]);
+  const char* output_filename = argv[4];
+
+  if (num_points <= 0 || num_dimensions <= 0) {
+    fprintf(stderr, "Erro: O número de pontos e de dimensões devem ser positivos.\n");
+    return EXIT_FAILURE;
+  }
+
+  FILE* input = fopen(input_filename, "r");
+  if (input == NULL) {
+    fprintf(stderr, "Erro: Não foi possível abrir o arquivo '%s'\n", input_filename);
+    return EXIT_FAILURE;
+  }
+  FILE* output = fopen(output_filename, "wb");
+  if (output == NULL) {
+    perror("Erro ao abrir o arquivo de saída");
+    fclose(input);
+    return EXIT_FAILURE;
+  }
+
+  KmbHeader header;
+  kmb_header_init(&header, num_points, num_dimensions);
+  kmb_write_header(output, &header);  // Provisório; regravado com intervalo e checksum no final
+
+  int* row = (int*)malloc(num_dimensions * sizeof(int));
+  for (int i = 0; i < num_points; i++) {
+    for (int j = 0; j < num_dimensions; j++) {
+      if (fscanf(input, "%d", &row[j]) != 1) {
+        fprintf(stderr, "Erro: Arquivo de dados mal formatado ou incompleto.\n");
+        fclose(input);
+        fclose(output);
+        remove(output_filename);
+        free(row);
+        return EXIT_FAILURE;
+      }
+    }
+    fwrite(row, sizeof(int), num_dimensions, output);
+    kmb_header_add(&header, row, num_dimensions);
+  }
+
+  int ok = kmb_write_header(output, &header);
+  ok = (fclose(output) == 0) && ok;
+  fclose(input);
+  free(row);
+  if (!ok) {
+    perror("Erro ao gravar o arquivo de saída");
+    return EXIT_FAILURE;
+  }
+
+  printf("'%s' convertido para '%s' (%d pontos, %d dimensões, valores em [%lld, %lld]).\n", input_filename,
+         output_filename, num_points, num_dimensions, (long long)header.min_val, (long long)header.max_val);
+  return EXIT_SUCCESS;
+}
@@ -1,17 +1,23 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include "kmeans_dataset.h"  // Formato binário .kmb
+
 /**
  * @brief Gera um arquivo de texto com um dataset de pontos com coordenadas inteiras.
  *
  * Este programa cria um arquivo contendo M pontos em um espaço D-dimensional,
  * com coordenadas inteiras aleatórias no intervalo [0, max_val].
+ * Se o nome do arquivo de saída terminar em ".kmb", grava no formato binário
+ * (ver kmeans_dataset.h) em vez de texto.
  */
 int main(int argc, char* argv[]) {
   if (argc != 5) {
     fprintf(stderr, "Uso: %s <num_pontos> <num_dimensoes> <max_val> <arquivo_saida>\n", argv[0]);
     fprintf(stderr, "Exemplo: %s 1000000 10 10000 dataset.txt\n", argv[0]);
+    fprintf(stderr, "         %s 1000000 10 10000 dataset.kmb  (formato binário)\n", argv[0]);
     return EXIT_FAILURE;
   }
 
@@ -25,7 +31,10 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
-  FILE* file = fopen(output_filename, "w");
+  size_t name_len = strlen(output_filename);
+  int binary = name_len > 4 && strcmp(output_filename + name_len - 4, ".kmb") == 0;
+
+  FILE* file = fopen(output_filename, binary ? "wb" : "w");
   if (file == NULL) {
     perror("Erro ao abrir o arquivo de saída");
     return EXIT_FAILURE;
@@ -36,14 +45,32 @@ int main(int argc, char* argv[]) {
   printf("Gerando '%s' com %d pontos, %d dimensões e valores até %d...\n",
          output_filename, num_points, num_dimensions, max_val);
 
+  KmbHeader header;
+  int* row = (int*)malloc(num_dimensions * sizeof(int));
+  if (binary) {
+    kmb_header_init(&header, num_points, num_dimensions);
+    kmb_write_header(file, &header);  // Provisório; regravado com intervalo e checksum no final
+  }
+
   for (int i = 0; i < num_points; i++) {
     for (int j = 0; j < num_dimensions; j++) {
       // Gera um inteiro aleatório no intervalo [0, max_val]
-      int random_val = rand() % (max_val + 1);
-      fprintf(file, "%d%c", random_val, (j == num_dimensions - 1) ? '\n' : ' ');
+      row[j] = rand() % (max_val + 1);
+      if (!binary) fprintf(file, "%d%c", row[j], (j == num_dimensions - 1) ? '\n' : ' ');
+    }
+    if (binary) {
+      fwrite(row, sizeof(int), num_dimensions, file);
+      kmb_header_add(&header, row, num_dimensions);
     }
   }
 
+  if (binary && !kmb_write_header(file, &header)) {
+    perror("Erro ao gravar o cabeçalho do arquivo de saída");
+    fclose(file);
+    free(row);
+    return EXIT_FAILURE;
+  }
+  free(row);
   fclose(file);
   printf("Dataset gerado com sucesso!\n");
 
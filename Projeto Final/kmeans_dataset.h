@@ -0,0 +1,644 @@
+// kmeans_dataset.h
+//
+// Leitura e escrita dos datasets do K-Means, compartilhada pelo gerador, pelo
+// conversor e pelas versões do K-Means. Tudo é 'static inline' para que cada
+// programa continue sendo compilado a partir de um único arquivo .c.
+//
+// Dois formatos são aceitos:
+//  - Texto: inteiros separados por espaço, um ponto por linha (gerador_dataset.c).
+//    É lido por um parser paralelo sobre o arquivo mapeado (usa pthreads:
+//    compilar com -pthread).
+//  - Binário (.kmb): cabeçalho de 64 bytes seguido das M * D coordenadas em
+//    ordem ponto-a-ponto, exatamente o layout de 'all_coords'. O arquivo é
+//    aberto com mmap e as coordenadas são usadas no lugar, sem cópia.
+#ifndef KMEANS_DATASET_H
+#define KMEANS_DATASET_H
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KMB_MAGIC "KMEANSB1"
+#define KMB_VERSION 1
+
+// Tipo das coordenadas gravadas no arquivo
+enum { KMB_INT32 = 1, KMB_INT16 = 2, KMB_INT8 = 3 };
+
+// Cabeçalho do formato binário (64 bytes; os dados começam alinhados a 64)
+typedef struct {
+  char magic[8];         // KMB_MAGIC
+  uint32_t version;      // KMB_VERSION
+  uint32_t dtype;        // KMB_INT32, KMB_INT16 ou KMB_INT8
+  uint64_t num_points;   // M
+  uint32_t num_dims;     // D
+  uint32_t header_size;  // Deslocamento dos dados a partir do início do arquivo
+  int64_t min_val;       // Menor coordenada do arquivo
+  int64_t max_val;       // Maior coordenada do arquivo
+  uint64_t checksum;     // FNV-1a de 64 bits dos bytes das coordenadas
+  uint8_t reserved[8];
+} KmbHeader;
+
+// Dataset carregado: coordenadas ponto-a-ponto (M * D) mais a origem delas
+typedef struct {
+  int* coords;      // Coordenadas (no mapeamento do arquivo ou em memória alocada)
+  void* map_base;   // Início do mapeamento (NULL se as coordenadas foram alocadas)
+  size_t map_size;  // Tamanho do mapeamento (ou das coordenadas do chamador)
+  int min_val;      // Menor coordenada
+  int max_val;      // Maior coordenada
+  int borrowed;     // 1 = coordenadas em memória do chamador (load_dataset_into)
+} Dataset;
+
+#define KMB_FNV_OFFSET 1469598103934665603ULL
+#define KMB_FNV_PRIME 1099511628211ULL
+
+/**
+ * @brief Continua o checksum FNV-1a de 64 bits com mais 'bytes' bytes.
+ */
+static inline uint64_t kmb_checksum_update(uint64_t hash, const void* data, size_t bytes) {
+  const unsigned char* p = (const unsigned char*)data;
+  for (size_t i = 0; i < bytes; i++) {
+    hash ^= p[i];
+    hash *= KMB_FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * @brief Prepara um cabeçalho para M pontos int32 de D dimensões. O intervalo e
+ * o checksum são acumulados com kmb_header_add enquanto os dados são gravados.
+ */
+static inline void kmb_header_init(KmbHeader* h, uint64_t M, uint32_t D) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->magic, KMB_MAGIC, sizeof(h->magic));
+  h->version = KMB_VERSION;
+  h->dtype = KMB_INT32;
+  h->num_points = M;
+  h->num_dims = D;
+  h->header_size = sizeof(KmbHeader);
+  h->min_val = INT32_MAX;
+  h->max_val = INT32_MIN;
+  h->checksum = KMB_FNV_OFFSET;
+}
+
+/**
+ * @brief Atualiza intervalo e checksum do cabeçalho com 'n' coordenadas gravadas.
+ */
+static inline void kmb_header_add(KmbHeader* h, const int* values, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (values[i] < h->min_val) h->min_val = values[i];
+    if (values[i] > h->max_val) h->max_val = values[i];
+  }
+  h->checksum = kmb_checksum_update(h->checksum, values, n * sizeof(int));
+}
+
+/**
+ * @brief Grava (ou regrava, ao final) o cabeçalho no início do arquivo.
+ * @return 1 em caso de sucesso, 0 em caso de erro de escrita.
+ */
+static inline int kmb_write_header(FILE* file, const KmbHeader* h) {
+  return fseek(file, 0, SEEK_SET) == 0 && fwrite(h, sizeof(*h), 1, file) == 1;
+}
+
+/**
+ * @brief Verifica se o arquivo começa com a assinatura do formato binário.
+ */
+static inline int kmb_is_binary(const char* filename) {
+  char magic[8];
+  FILE* file = fopen(filename, "rb");
+  if (file == NULL) return 0;
+  int is_binary = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, KMB_MAGIC, sizeof(magic)) == 0;
+  fclose(file);
+  return is_binary;
+}
+
+/**
+ * @brief Lê M * D inteiros de um arquivo de texto com fscanf (formato original).
+ * Usado quando o arquivo não pode ser mapeado (ex.: pipes).
+ * Encerra o programa se o arquivo não puder ser aberto ou estiver incompleto.
+ */
+static inline void read_text_dataset_fscanf(const char* filename, int* coords, int M, int D) {
+  FILE* file = fopen(filename, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Erro: Não foi possível abrir o arquivo '%s'\n", filename);
+    exit(EXIT_FAILURE);
+  }
+
+  for (size_t i = 0; i < (size_t)M * D; i++) {
+    if (fscanf(file, "%d", &coords[i]) != 1) {
+      fprintf(stderr, "Erro: Arquivo de dados mal formatado ou incompleto.\n");
+      fclose(file);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  fclose(file);
+}
+
+// --- Parser paralelo do formato texto ---
+
+// Tamanho mínimo do trecho de arquivo de cada thread do parser
+#ifndef TEXT_CHUNK_MIN_BYTES
+#define TEXT_CHUNK_MIN_BYTES (1 << 20)
+#endif
+
+// Trecho do arquivo texto atribuído a uma thread do parser
+typedef struct {
+  const char* begin;
+  const char* end;
+  size_t count;   // Passo 1: inteiros válidos no trecho antes do fim ou de um erro
+  int malformed;  // Passo 1: 1 se o trecho tem um token inválido logo após 'count' inteiros
+  int* out;       // Passo 2: destino do primeiro inteiro do trecho (NULL = não copiar)
+  size_t wanted;  // Passo 2: quantos inteiros do trecho copiar
+} TextChunk;
+
+static inline int text_is_space(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+/**
+ * @brief Percorre um trecho com as mesmas regras do fscanf("%d"): ignora espaços,
+ * aceita um sinal opcional seguido de ao menos um dígito e para no primeiro
+ * caractere que não é dígito. Um token que não começa assim é inválido, como
+ * no fscanf, e encerra o trecho. Se 'out' não for NULL, grava até 'wanted'
+ * inteiros. O laço dos dígitos não tem desvios além do teste de fim do número.
+ */
+static inline void parse_text_chunk(TextChunk* c, int* out, size_t wanted) {
+  const unsigned char* p = (const unsigned char*)c->begin;
+  const unsigned char* end = (const unsigned char*)c->end;
+  size_t count = 0;
+  c->malformed = 0;
+
+  while (count < wanted) {
+    while (p < end && text_is_space(*p)) p++;
+    if (p == end) break;
+
+    int negative = *p == '-';
+    const unsigned char* digits = p + (*p == '-' || *p == '+');
+    unsigned long long value = 0;
+    const unsigned char* q = digits;
+    while (q < end && (unsigned)(*q - '0') < 10) {
+      value = value * 10 + (unsigned)(*q - '0');
+      q++;
+    }
+    if (q == digits) {
+      c->malformed = 1;
+      break;
+    }
+    if (out != NULL) out[count] = (int)(negative ? 0 - value : value);
+    count++;
+    p = q;
+  }
+  c->count = count;
+}
+
+static inline void* count_text_chunk_thread(void* arg) {
+  TextChunk* c = (TextChunk*)arg;
+  parse_text_chunk(c, NULL, (size_t)-1);
+  return NULL;
+}
+
+static inline void* parse_text_chunk_thread(void* arg) {
+  TextChunk* c = (TextChunk*)arg;
+  if (c->out != NULL) parse_text_chunk(c, c->out, c->wanted);
+  return NULL;
+}
+
+/**
+ * @brief Executa 'fn' em uma thread por trecho.
+ */
+static inline void run_text_chunks(TextChunk* chunks, int num_chunks, void* (*fn)(void*)) {
+  pthread_t* threads = (pthread_t*)malloc(num_chunks * sizeof(pthread_t));
+  for (int t = 1; t < num_chunks; t++) {
+    if (pthread_create(&threads[t], NULL, fn, &chunks[t]) != 0) {
+      fprintf(stderr, "Erro: Não foi possível criar a thread do parser.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  fn(&chunks[0]);  // A thread principal fica com o primeiro trecho
+  for (int t = 1; t < num_chunks; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  free(threads);
+}
+
+/**
+ * @brief Lê M * D inteiros de um arquivo de texto com o mesmo resultado e o mesmo
+ * tratamento de erro do fscanf: os primeiros M * D inteiros do arquivo vão
+ * para 'coords' e o programa é encerrado se algum deles faltar ou se um token
+ * inválido aparecer antes deles. O arquivo é mapeado e dividido em trechos
+ * que terminam em fim de linha, um por núcleo. No passo 1 cada thread conta os
+ * inteiros do seu trecho; a soma de prefixos dá a posição de cada trecho no
+ * vetor, e no passo 2 cada thread converte o seu trecho direto para 'coords'.
+ */
+static inline void read_text_dataset(const char* filename, int* coords, int M, int D) {
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0) {
+    fprintf(stderr, "Erro: Não foi possível abrir o arquivo '%s'\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    read_text_dataset_fscanf(filename, coords, M, D);
+    return;
+  }
+  const char* text = (const char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == MAP_FAILED) {
+    read_text_dataset_fscanf(filename, coords, M, D);
+    return;
+  }
+  madvise((void*)text, st.st_size, MADV_SEQUENTIAL);
+
+  size_t size = st.st_size;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int num_chunks = (int)(size / TEXT_CHUNK_MIN_BYTES);
+  if (num_chunks > cores) num_chunks = (int)cores;
+  if (num_chunks < 1) num_chunks = 1;
+
+  // Fronteiras aproximadas, empurradas até logo depois do próximo '\n'
+  TextChunk* chunks = (TextChunk*)calloc(num_chunks, sizeof(TextChunk));
+  const char* cursor = text;
+  for (int t = 0; t < num_chunks; t++) {
+    chunks[t].begin = cursor;
+    const char* end = t == num_chunks - 1 ? text + size : text + size / num_chunks * (t + 1);
+    if (end < cursor) end = cursor;
+    const char* newline = (const char*)memchr(end, '\n', text + size - end);
+    chunks[t].end = newline != NULL && t != num_chunks - 1 ? newline + 1 : text + size;
+    cursor = chunks[t].end;
+  }
+
+  run_text_chunks(chunks, num_chunks, count_text_chunk_thread);
+
+  // Soma de prefixos: posição de cada trecho no fluxo de inteiros do arquivo
+  size_t needed = (size_t)M * D, offset = 0;
+  int complete = 0;
+  for (int t = 0; t < num_chunks && !complete; t++) {
+    size_t take = chunks[t].count < needed - offset ? chunks[t].count : needed - offset;
+    chunks[t].out = &coords[offset];
+    chunks[t].wanted = take;
+    offset += take;
+    complete = offset == needed;
+    if (!complete && chunks[t].malformed) break;  // token inválido antes dos M * D inteiros
+  }
+
+  if (complete) run_text_chunks(chunks, num_chunks, parse_text_chunk_thread);
+
+  munmap((void*)text, size);
+  free(chunks);
+  if (!complete) {
+    fprintf(stderr, "Erro: Arquivo de dados mal formatado ou incompleto.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief Confere assinatura, versão, tipo e tamanho de um cabeçalho .kmb e se o
+ * arquivo tem ao menos M pontos de exatamente D dimensões. Encerra o programa
+ * em caso de erro.
+ */
+static inline void validate_kmb_header(const KmbHeader* h, size_t file_size, const char* filename, int M, int D) {
+  size_t data_bytes = (size_t)h->num_points * h->num_dims * sizeof(int);
+  if (memcmp(h->magic, KMB_MAGIC, 8) != 0 || h->version != KMB_VERSION || h->header_size < sizeof(KmbHeader) ||
+      file_size < h->header_size + data_bytes) {
+    fprintf(stderr, "Erro: Arquivo de dados mal formatado ou incompleto.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (h->dtype != KMB_INT32) {
+    fprintf(stderr, "Erro: Tipo de coordenada %u não suportado em '%s'.\n", h->dtype, filename);
+    exit(EXIT_FAILURE);
+  }
+  if (h->num_dims != (uint32_t)D || h->num_points < (uint64_t)M) {
+    fprintf(stderr, "Erro: '%s' tem %llu pontos de %u dimensões; pedido: %d pontos de %d dimensões.\n", filename,
+            (unsigned long long)h->num_points, h->num_dims, M, D);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief Mapeia um arquivo .kmb e valida cabeçalho, tamanho e checksum.
+ * Os primeiros M pontos do arquivo são usados, assim como no formato texto;
+ * D precisa ser igual ao do arquivo.
+ */
+static inline void map_binary_dataset(const char* filename, int M, int D, Dataset* ds) {
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "Erro: Não foi possível abrir o arquivo '%s'\n", filename);
+    exit(EXIT_FAILURE);
+  }
+
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE;  // Carrega as páginas já aqui, fora da medição de tempo
+#endif
+  void* base = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "Erro: Não foi possível mapear o arquivo '%s'\n", filename);
+    exit(EXIT_FAILURE);
+  }
+
+  const KmbHeader* h = (const KmbHeader*)base;
+  if ((size_t)st.st_size < sizeof(KmbHeader)) {
+    fprintf(stderr, "Erro: Arquivo de dados mal formatado ou incompleto.\n");
+    exit(EXIT_FAILURE);
+  }
+  validate_kmb_header(h, st.st_size, filename, M, D);
+
+  size_t data_bytes = (size_t)h->num_points * h->num_dims * sizeof(int);
+  const unsigned char* data = (const unsigned char*)base + h->header_size;
+  if (kmb_checksum_update(KMB_FNV_OFFSET, data, data_bytes) != h->checksum) {
+    fprintf(stderr, "Erro: Checksum do arquivo '%s' não confere.\n", filename);
+    exit(EXIT_FAILURE);
+  }
+
+  ds->coords = (int*)data;
+  ds->map_base = base;
+  ds->map_size = st.st_size;
+  ds->min_val = (int)h->min_val;
+  ds->max_val = (int)h->max_val;
+}
+
+/**
+ * @brief Menor e maior coordenada dos M * D valores de ds->coords.
+ */
+static inline void dataset_find_range(Dataset* ds, int M, int D) {
+  ds->min_val = ds->coords[0];
+  ds->max_val = ds->coords[0];
+  for (size_t i = 1; i < (size_t)M * D; i++) {
+    if (ds->coords[i] < ds->min_val) ds->min_val = ds->coords[i];
+    if (ds->coords[i] > ds->max_val) ds->max_val = ds->coords[i];
+  }
+}
+
+/**
+ * @brief Carrega os M pontos de D dimensões de 'filename', detectando o formato
+ * pela assinatura. No formato binário as coordenadas ficam no mapeamento do
+ * arquivo (somente leitura); no formato texto são alocadas e lidas com fscanf.
+ */
+static inline void load_dataset(const char* filename, int M, int D, Dataset* ds) {
+  memset(ds, 0, sizeof(*ds));
+  if (kmb_is_binary(filename)) {
+    map_binary_dataset(filename, M, D, ds);
+    return;
+  }
+
+  ds->coords = (int*)malloc((size_t)M * D * sizeof(int));
+  if (ds->coords == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar memória para %d pontos.\n", M);
+    exit(EXIT_FAILURE);
+  }
+  read_text_dataset(filename, ds->coords, M, D);
+  dataset_find_range(ds, M, D);
+}
+
+/**
+ * @brief Libera o mapeamento ou a memória das coordenadas. Coordenadas do
+ * chamador não são liberadas, mas suas páginas inteiras são devolvidas ao
+ * sistema (o conteúdo deixa de valer).
+ */
+static inline void free_dataset(Dataset* ds) {
+  if (ds->borrowed) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t begin = ((size_t)ds->coords + page - 1) / page * page;
+    size_t end = ((size_t)ds->coords + ds->map_size) / page * page;
+    if (end > begin) madvise((void*)begin, end - begin, MADV_DONTNEED);
+  } else if (ds->map_base != NULL) {
+    munmap(ds->map_base, ds->map_size);
+  } else {
+    free(ds->coords);
+  }
+  ds->coords = NULL;
+}
+
+/**
+ * @brief Como load_dataset, mas um arquivo texto é lido direto em 'coords'
+ * (M * D inteiros fornecidos pelo chamador, ex.: uma arena com páginas
+ * enormes). Um arquivo .kmb continua sendo usado no mapeamento, sem cópia, e
+ * 'coords' não é tocado: use kmb_is_binary para decidir se vale reservá-lo.
+ */
+static inline void load_dataset_into(const char* filename, int M, int D, Dataset* ds, int* coords) {
+  if (kmb_is_binary(filename)) {
+    load_dataset(filename, M, D, ds);
+    return;
+  }
+  memset(ds, 0, sizeof(*ds));
+  read_text_dataset(filename, coords, M, D);
+  ds->coords = coords;
+  dataset_find_range(ds, M, D);
+  ds->map_size = (size_t)M * D * sizeof(int);
+  ds->borrowed = 1;
+}
+
+/**
+ * @brief Pede páginas enormes transparentes para o mapeamento de um .kmb
+ * (huge = 1) ou as proíbe (huge = 0). Só tem efeito em kernels com THP para
+ * arquivos somente leitura; sem isso o mapeamento fica em páginas normais.
+ */
+static inline void dataset_advise_pages(Dataset* ds, int huge) {
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+  if (ds->map_base != NULL && !ds->borrowed) {
+    madvise(ds->map_base, ds->map_size, huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+  }
+#else
+  (void)ds;
+  (void)huge;
+#endif
+}
+
+// --- Leitura em fluxo (out-of-core) ---
+
+/*
+ * Leitor com buffer duplo para datasets .kmb maiores que a memória. Uma thread
+ * leitora percorre o arquivo em trechos de 'chunk_points' pontos, 'passes'
+ * vezes (uma por iteração do K-Means), preenchendo alternadamente os dois
+ * buffers; enquanto o consumidor processa um trecho, o próximo já está sendo
+ * lido. A sincronização segue o produtor-consumidor com mutex e variáveis de
+ * condição, com um buffer circular de 2 posições.
+ */
+typedef struct {
+  int fd;
+  off_t data_offset;  // Início das coordenadas no arquivo
+  int M, D;
+  int chunk_points;  // Pontos por trecho
+  int num_chunks;    // Trechos por passada
+  int passes;        // Passadas que a thread leitora vai fazer
+
+  int* buffers[2];
+  int counts[2];  // Pontos em cada buffer
+  int full[2];    // 1 quando o buffer tem um trecho ainda não consumido
+  long long consumed;
+  int stop;  // Pede à thread leitora que encerre antes das passadas previstas
+
+  uint64_t checksum;  // FNV-1a acumulado na primeira passada
+  uint64_t expected_checksum;
+  int verify_checksum;  // Só quando os M pontos são o arquivo inteiro
+
+  pthread_mutex_t mutex;
+  pthread_cond_t filled;
+  pthread_cond_t emptied;
+  pthread_t thread;
+} StreamReader;
+
+/**
+ * @brief Lê 'count' pontos a partir do ponto 'first' com pread.
+ */
+static inline void read_points_at(int fd, off_t data_offset, int D, long long first, int count, int* out) {
+  size_t bytes = (size_t)count * D * sizeof(int);
+  off_t offset = data_offset + (off_t)first * D * sizeof(int);
+  char* dst = (char*)out;
+  while (bytes > 0) {
+    ssize_t n = pread(fd, dst, bytes, offset);
+    if (n <= 0) {
+      fprintf(stderr, "Erro: Falha ao ler o arquivo de dados.\n");
+      exit(EXIT_FAILURE);
+    }
+    dst += n;
+    offset += n;
+    bytes -= n;
+  }
+}
+
+static inline void* stream_reader_thread(void* arg) {
+  StreamReader* r = (StreamReader*)arg;
+  long long produced = 0;
+
+  for (int pass = 0; pass < r->passes; pass++) {
+    for (int c = 0; c < r->num_chunks; c++, produced++) {
+      int slot = produced % 2;
+      pthread_mutex_lock(&r->mutex);
+      while (r->full[slot] && !r->stop) pthread_cond_wait(&r->emptied, &r->mutex);
+      int stop = r->stop;
+      pthread_mutex_unlock(&r->mutex);
+      if (stop) return NULL;
+
+      long long first = (long long)c * r->chunk_points;
+      int count = first + r->chunk_points < r->M ? r->chunk_points : (int)(r->M - first);
+      read_points_at(r->fd, r->data_offset, r->D, first, count, r->buffers[slot]);
+      if (pass == 0 && r->verify_checksum) {
+        r->checksum = kmb_checksum_update(r->checksum, r->buffers[slot], (size_t)count * r->D * sizeof(int));
+      }
+
+      pthread_mutex_lock(&r->mutex);
+      r->counts[slot] = count;
+      r->full[slot] = 1;
+      pthread_cond_signal(&r->filled);
+      pthread_mutex_unlock(&r->mutex);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Abre um .kmb para leitura em fluxo (valida o cabeçalho, sem ler os dados).
+ * A thread leitora só começa em stream_start.
+ */
+static inline void stream_open(StreamReader* r, const char* filename, int M, int D, int chunk_points) {
+  memset(r, 0, sizeof(*r));
+  KmbHeader h;
+  struct stat st;
+  r->fd = open(filename, O_RDONLY);
+  if (r->fd < 0 || fstat(r->fd, &st) != 0) {
+    fprintf(stderr, "Erro: Não foi possível abrir o arquivo '%s'\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  if (pread(r->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+    fprintf(stderr, "Erro: O modo em fluxo exige um dataset binário .kmb (veja conversor_dataset.c).\n");
+    exit(EXIT_FAILURE);
+  }
+  if (memcmp(h.magic, KMB_MAGIC, 8) != 0) {
+    fprintf(stderr, "Erro: O modo em fluxo exige um dataset binário .kmb (veja conversor_dataset.c).\n");
+    exit(EXIT_FAILURE);
+  }
+  validate_kmb_header(&h, st.st_size, filename, M, D);
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(r->fd, h.header_size, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  r->data_offset = h.header_size;
+  r->M = M;
+  r->D = D;
+  r->chunk_points = chunk_points < M ? chunk_points : M;
+  r->num_chunks = (M + r->chunk_points - 1) / r->chunk_points;
+  r->checksum = KMB_FNV_OFFSET;
+  r->expected_checksum = h.checksum;
+  r->verify_checksum = h.num_points == (uint64_t)M;
+  for (int b = 0; b < 2; b++) {
+    r->buffers[b] = (int*)malloc((size_t)r->chunk_points * D * sizeof(int));
+    if (r->buffers[b] == NULL) {
+      fprintf(stderr, "Erro: Falha ao alocar o buffer de leitura em fluxo.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  pthread_mutex_init(&r->mutex, NULL);
+  pthread_cond_init(&r->filled, NULL);
+  pthread_cond_init(&r->emptied, NULL);
+}
+
+/**
+ * @brief Inicia a thread leitora para 'passes' passadas completas pelo arquivo.
+ */
+static inline void stream_start(StreamReader* r, int passes) {
+  r->passes = passes;
+  if (pthread_create(&r->thread, NULL, stream_reader_thread, r) != 0) {
+    fprintf(stderr, "Erro: Não foi possível criar a thread de leitura.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief Espera o próximo trecho. Devolve o buffer e, em 'count', seus pontos.
+ * O buffer pertence ao consumidor até stream_release.
+ */
+static inline const int* stream_next(StreamReader* r, int* count) {
+  int slot = r->consumed % 2;
+  pthread_mutex_lock(&r->mutex);
+  while (!r->full[slot]) pthread_cond_wait(&r->filled, &r->mutex);
+  *count = r->counts[slot];
+  pthread_mutex_unlock(&r->mutex);
+  return r->buffers[slot];
+}
+
+/**
+ * @brief Devolve o buffer do trecho atual para a thread leitora. Ao final da
+ * primeira passada, confere o checksum do arquivo.
+ */
+static inline void stream_release(StreamReader* r) {
+  int slot = r->consumed % 2;
+  pthread_mutex_lock(&r->mutex);
+  r->full[slot] = 0;
+  pthread_cond_signal(&r->emptied);
+  pthread_mutex_unlock(&r->mutex);
+  r->consumed++;
+
+  if (r->consumed == r->num_chunks && r->verify_checksum && r->checksum != r->expected_checksum) {
+    fprintf(stderr, "Erro: Checksum do arquivo de dados não confere.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief Encerra a thread leitora (mesmo no meio das passadas) e libera o leitor.
+ */
+static inline void stream_close(StreamReader* r) {
+  if (r->passes > 0) {
+    pthread_mutex_lock(&r->mutex);
+    r->stop = 1;
+    pthread_cond_broadcast(&r->emptied);
+    pthread_mutex_unlock(&r->mutex);
+    pthread_join(r->thread, NULL);
+  }
+  pthread_mutex_destroy(&r->mutex);
+  pthread_cond_destroy(&r->filled);
+  pthread_cond_destroy(&r->emptied);
+  free(r->buffers[0]);
+  free(r->buffers[1]);
+  close(r->fd);
+}
+
+#endif
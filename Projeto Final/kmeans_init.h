@@ -0,0 +1,387 @@
+// kmeans_init.h
+//
+// Estratégias de inicialização dos centroides, compartilhadas pelas versões do
+// K-Means. Como kmeans_dataset.h, tudo é 'static inline' para que cada
+// programa continue sendo compilado a partir de um único arquivo .c.
+//
+//  - random:   o embaralhamento original com srand(42) (padrão). Fica em cada
+//              programa, pois define o checksum de referência.
+//  - kmeans++: o primeiro centro é um ponto uniforme; cada centro seguinte é
+//              sorteado com probabilidade proporcional a d(x)², a distância
+//              ao centro mais próximo já escolhido. K passadas sobre os dados.
+//  - kmeans||: (k-means escalável) em INIT_ROUNDS rodadas, cada ponto entra
+//              como candidato com probabilidade min(1, l * d(x)² / phi), em
+//              que phi é a soma de d(x)² e l = INIT_OVERSAMPLING * K. Os
+//              candidatos recebem como peso o número de pontos mais próximos
+//              deles e são reduzidos a K centros por um k-means++ ponderado.
+//
+// Os sorteios não usam rand(): cada um é um hash de (semente, fluxo, índices),
+// e todas as somas são inteiras (128 bits). Assim o resultado é o mesmo com
+// qualquer número de threads ou processos: a versão MPI compõe as funções
+// abaixo com coletivas e escolhe exatamente os mesmos centros que a
+// sequencial. A atualização das distâncias usa OpenMP quando o programa é
+// compilado com -fopenmp; sem ele, roda no executor registrado em
+// init_executor (o pool da versão Pthreads) ou, na falta dele, em série.
+#ifndef KMEANS_INIT_H
+#define KMEANS_INIT_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Estratégias de inicialização dos centroides
+typedef enum {
+  INIT_RANDOM,          // Embaralhamento original com srand(42) (padrão)
+  INIT_KMEANSPP,        // k-means++
+  INIT_KMEANS_PARALLEL  // k-means|| (sobreamostragem em rodadas + k-means++ ponderado)
+} InitStrategy;
+
+// Semente dos sorteios de kmeans++ e kmeans||
+#define INIT_SEED 42
+
+// Rodadas de sobreamostragem do kmeans||
+#define INIT_ROUNDS 5
+
+// Candidatos esperados por rodada do kmeans||, em múltiplos de K
+#define INIT_OVERSAMPLING 1
+
+// Fluxos independentes de números aleatórios (o mini-batch da versão sequencial usa o último)
+enum { INIT_STREAM_CENTER = 1, INIT_STREAM_ROUND = 2, INIT_STREAM_REDUCE = 3, INIT_STREAM_MINIBATCH = 4 };
+
+/**
+ * @brief Converte o nome da opção --init=<nome>.
+ * @return 1 em caso de sucesso, 0 se o nome for desconhecido.
+ */
+static inline int init_parse(const char* name, InitStrategy* strategy) {
+  if (strcmp(name, "random") == 0) {
+    *strategy = INIT_RANDOM;
+  } else if (strcmp(name, "kmeans++") == 0) {
+    *strategy = INIT_KMEANSPP;
+  } else if (strcmp(name, "kmeans||") == 0) {
+    *strategy = INIT_KMEANS_PARALLEL;
+  } else {
+    return 0;
+  }
+  return 1;
+}
+
+static inline const char* init_name(InitStrategy strategy) {
+  return strategy == INIT_KMEANSPP ? "kmeans++" : strategy == INIT_KMEANS_PARALLEL ? "kmeans||" : "random";
+}
+
+// --- Números Aleatórios ---
+
+// Finalizador do SplitMix64: espalha bem bits de entradas consecutivas
+static inline uint64_t init_mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+static inline uint64_t init_hash(uint64_t seed, uint64_t stream, uint64_t a, uint64_t b) {
+  return init_mix(init_mix(init_mix(seed ^ (stream << 56)) ^ a) ^ b);
+}
+
+/**
+ * @brief Inteiro em [0, n) (n > 0) determinado só por (semente, fluxo, a, b).
+ * Usa 128 bits aleatórios, então o viés do módulo é desprezível.
+ */
+static inline unsigned __int128 init_uniform(uint64_t seed, uint64_t stream, uint64_t a, uint64_t b,
+                                             unsigned __int128 n) {
+  unsigned __int128 r = ((unsigned __int128)init_hash(seed, stream, a, 2 * b) << 64) |
+                        init_hash(seed, stream, a, 2 * b + 1);
+  return r % n;
+}
+
+// --- Executor Paralelo ---
+
+// Corpo de um laço sobre os pontos [begin, end)
+typedef void (*InitRangeBody)(void* arg, int begin, int end);
+
+/*
+ * Executor opcional para programas sem OpenMP: run(ctx, count, body, arg)
+ * divide [0, count) em faixas disjuntas, chama body em cada uma (em qualquer
+ * thread) e só retorna quando todas terminaram. Cada faixa escreve só os seus
+ * pontos, então o resultado não depende da divisão.
+ */
+typedef struct {
+  void (*run)(void* ctx, int count, InitRangeBody body, void* arg);
+  void* ctx;
+} InitExecutor;
+
+static InitExecutor init_executor = {NULL, NULL};
+
+// --- Primitivas sobre uma Faixa de Pontos ---
+
+static inline long long init_dist_sq(const int* a, const int* b, int D) {
+  long long dist = 0;
+  for (int d = 0; d < D; d++) {
+    long long diff = (long long)a[d] - b[d];
+    dist += diff * diff;
+  }
+  return dist;
+}
+
+/**
+ * @brief Distância ao quadrado, abandonada assim que alcança 'bound' (o valor
+ * retornado então é apenas >= bound). Quase todos os candidatos estão longe do
+ * ponto, então a maioria das comparações para nas primeiras dimensões.
+ */
+static inline long long init_dist_sq_bounded(const int* a, const int* b, int D, long long bound) {
+  long long dist = 0;
+  for (int d = 0; d < D; d++) {
+    long long diff = (long long)a[d] - b[d];
+    dist += diff * diff;
+    if (dist >= bound) break;
+  }
+  return dist;
+}
+
+// Argumentos de init_update_range
+typedef struct {
+  const int* coords;
+  int D;
+  const int* centers;
+  int num_centers, first_center;
+  long long* min_dist;
+  int* nearest;
+} InitUpdateArgs;
+
+static inline __attribute__((always_inline)) void init_update_points(const InitUpdateArgs* a, int num_centers,
+                                                                     int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    const int* x = &a->coords[(size_t)i * a->D];
+    long long best = a->min_dist[i];
+    for (int c = 0; c < num_centers; c++) {
+      long long dist = init_dist_sq_bounded(x, &a->centers[(size_t)c * a->D], a->D, best);
+      if (dist < best) {
+        best = dist;
+        if (a->nearest != NULL) a->nearest[i] = a->first_center + c;
+      }
+    }
+    a->min_dist[i] = best;
+  }
+}
+
+static inline void init_update_range(void* arg, int begin, int end) {
+  // Cópia local: as escritas em nearest[] poderiam apelidar os campos inteiros
+  const InitUpdateArgs a = *(const InitUpdateArgs*)arg;
+  // Um centro por vez é o caso do kmeans++ (K passadas); a versão especializada evita o laço interno
+  if (a.num_centers == 1) {
+    init_update_points(&a, 1, begin, end);
+  } else {
+    init_update_points(&a, a.num_centers, begin, end);
+  }
+}
+
+/**
+ * @brief Atualiza min_dist[i] com os centros novos 'centers' (num_centers
+ * centros, de índice global first_center em diante) e, se 'nearest' não for
+ * NULL, o índice do centro mais próximo (empate: menor índice).
+ * @return A soma de min_dist sobre os 'count' pontos.
+ */
+static inline unsigned __int128 init_update_min_dist(const int* coords, int count, int D, const int* centers,
+                                                     int num_centers, int first_center, long long* min_dist,
+                                                     int* nearest) {
+  InitUpdateArgs args = {coords, D, centers, num_centers, first_center, min_dist, nearest};
+  if (init_executor.run != NULL) {
+    init_executor.run(init_executor.ctx, count, init_update_range, &args);
+  } else {
+#ifdef _OPENMP
+#pragma omp parallel
+    {
+      long long t = omp_get_thread_num(), team = omp_get_num_threads();
+      init_update_range(&args, (int)(count * t / team), (int)(count * (t + 1) / team));
+    }
+#else
+    init_update_range(&args, 0, count);
+#endif
+  }
+
+  unsigned __int128 total = 0;
+  for (int i = 0; i < count; i++) {
+    total += (unsigned long long)min_dist[i];
+  }
+  return total;
+}
+
+/**
+ * @brief Primeiro índice cuja soma acumulada de 'weights' passa de 'target'
+ * (0 <= target < soma total).
+ */
+static inline int init_pick_weighted(const long long* weights, int count, unsigned __int128 target) {
+  unsigned __int128 prefix = 0;
+  for (int i = 0; i < count; i++) {
+    prefix += (unsigned long long)weights[i];
+    if (prefix > target) return i;
+  }
+  return count - 1;
+}
+
+/**
+ * @brief Uma rodada de sobreamostragem do kmeans||: o ponto i (índice global
+ * first + i) entra com probabilidade min(1, ell * min_dist[i] / phi), phi > 0.
+ * @return Quantos índices locais foram escritos em 'selected', em ordem.
+ */
+static inline int init_sample_round(const long long* min_dist, int count, long long first, unsigned __int128 phi,
+                                    long long ell, uint64_t seed, int round, int* selected) {
+  int num_selected = 0;
+  for (int i = 0; i < count; i++) {
+    if (min_dist[i] > 0 &&
+        init_uniform(seed, INIT_STREAM_ROUND, round, first + i, phi) < (unsigned __int128)ell * min_dist[i]) {
+      selected[num_selected++] = i;
+    }
+  }
+  return num_selected;
+}
+
+/**
+ * @brief Reduz C candidatos com pesos a K centros por k-means++ ponderado
+ * (o peso multiplica d²). Se sobrarem só candidatos já escolhidos, repete um
+ * candidato uniforme. Determinístico: depende só das entradas e da semente.
+ */
+static inline void init_reduce_candidates(const int* cands, const long long* weights, int C, int D, int K,
+                                          uint64_t seed, int* centers) {
+  long long* min_dist = (long long*)malloc((size_t)C * sizeof(long long));
+  if (min_dist == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar a inicialização dos centroides.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int c = 0; c < C; c++) {
+    min_dist[c] = LLONG_MAX;
+  }
+
+  for (int k = 0; k < K; k++) {
+    unsigned __int128 total = 0;
+    for (int c = 0; c < C; c++) {
+      total += (unsigned __int128)(unsigned long long)weights[c] * (k == 0 ? 1 : (unsigned long long)min_dist[c]);
+    }
+
+    int chosen = C - 1;
+    if (total == 0) {
+      chosen = (int)init_uniform(seed, INIT_STREAM_REDUCE, k, 1, C);
+    } else {
+      unsigned __int128 target = init_uniform(seed, INIT_STREAM_REDUCE, k, 0, total);
+      unsigned __int128 prefix = 0;
+      for (int c = 0; c < C; c++) {
+        prefix += (unsigned __int128)(unsigned long long)weights[c] * (k == 0 ? 1 : (unsigned long long)min_dist[c]);
+        if (prefix > target) {
+          chosen = c;
+          break;
+        }
+      }
+    }
+    memcpy(&centers[(size_t)k * D], &cands[(size_t)chosen * D], D * sizeof(int));
+
+    for (int c = 0; c < C; c++) {
+      long long dist = init_dist_sq(&cands[(size_t)c * D], &centers[(size_t)k * D], D);
+      if (dist < min_dist[c]) min_dist[c] = dist;
+    }
+  }
+  free(min_dist);
+}
+
+// --- Inicialização com Todos os Pontos em Memória ---
+
+static inline long long* init_alloc_min_dist(int M) {
+  long long* min_dist = (long long*)malloc((size_t)M * sizeof(long long));
+  if (min_dist == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar a inicialização dos centroides.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < M; i++) {
+    min_dist[i] = LLONG_MAX;
+  }
+  return min_dist;
+}
+
+/**
+ * @brief k-means++ sobre os M pontos 'coords' (ponto a ponto); escreve os K
+ * centros em 'centers' (K * D).
+ */
+static inline void init_kmeanspp(const int* coords, int M, int D, int K, uint64_t seed, int* centers) {
+  long long* min_dist = init_alloc_min_dist(M);
+
+  int first = (int)init_uniform(seed, INIT_STREAM_CENTER, 0, 0, M);
+  memcpy(centers, &coords[(size_t)first * D], D * sizeof(int));
+  for (int k = 1; k < K; k++) {
+    unsigned __int128 total = init_update_min_dist(coords, M, D, &centers[(size_t)(k - 1) * D], 1, k - 1, min_dist,
+                                                   NULL);
+    int chosen = total == 0 ? (int)init_uniform(seed, INIT_STREAM_CENTER, k, 0, M)
+                            : init_pick_weighted(min_dist, M, init_uniform(seed, INIT_STREAM_CENTER, k, 1, total));
+    memcpy(&centers[(size_t)k * D], &coords[(size_t)chosen * D], D * sizeof(int));
+  }
+  free(min_dist);
+}
+
+/**
+ * @brief k-means|| sobre os M pontos 'coords'; escreve os K centros em
+ * 'centers' (K * D).
+ */
+static inline void init_kmeans_parallel(const int* coords, int M, int D, int K, uint64_t seed, int* centers) {
+  long long* min_dist = init_alloc_min_dist(M);
+  int* nearest = (int*)malloc((size_t)M * sizeof(int));
+  int* selected = (int*)malloc((size_t)M * sizeof(int));
+  int* cands = (int*)malloc((size_t)D * sizeof(int));
+  if (nearest == NULL || selected == NULL || cands == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar a inicialização dos centroides.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  int first = (int)init_uniform(seed, INIT_STREAM_CENTER, 0, 0, M);
+  memcpy(cands, &coords[(size_t)first * D], D * sizeof(int));
+  int C = 1;
+  unsigned __int128 phi = init_update_min_dist(coords, M, D, cands, 1, 0, min_dist, nearest);
+
+  for (int round = 0; round < INIT_ROUNDS && phi > 0; round++) {
+    int n = init_sample_round(min_dist, M, 0, phi, (long long)INIT_OVERSAMPLING * K, seed, round, selected);
+    cands = (int*)realloc(cands, (size_t)(C + n) * D * sizeof(int));
+    if (cands == NULL) {
+      fprintf(stderr, "Erro: Falha ao alocar a inicialização dos centroides.\n");
+      exit(EXIT_FAILURE);
+    }
+    for (int s = 0; s < n; s++) {
+      memcpy(&cands[(size_t)(C + s) * D], &coords[(size_t)selected[s] * D], D * sizeof(int));
+    }
+    phi = init_update_min_dist(coords, M, D, &cands[(size_t)C * D], n, C, min_dist, nearest);
+    C += n;
+  }
+
+  long long* weights = (long long*)calloc(C, sizeof(long long));
+  for (int i = 0; i < M; i++) {
+    weights[nearest[i]]++;
+  }
+  init_reduce_candidates(cands, weights, C, D, K, seed, centers);
+
+  free(weights);
+  free(cands);
+  free(selected);
+  free(nearest);
+  free(min_dist);
+}
+
+/**
+ * @brief Executa kmeans++ ou kmeans|| (INIT_RANDOM fica a cargo do programa)
+ * e relata o tempo gasto em stderr.
+ */
+static inline void init_centers(InitStrategy strategy, const int* coords, int M, int D, int K, int* centers) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (strategy == INIT_KMEANSPP) {
+    init_kmeanspp(coords, M, D, K, INIT_SEED, centers);
+  } else {
+    init_kmeans_parallel(coords, M, D, K, INIT_SEED, centers);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  fprintf(stderr, "Inicialização %s: %.3f s\n", init_name(strategy),
+          (end.tv_sec - start.tv_sec) + 1e-9 * (end.tv_nsec - start.tv_nsec));
+}
+
+#endif  // KMEANS_INIT_H
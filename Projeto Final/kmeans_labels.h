@@ -0,0 +1,75 @@
+// kmeans_labels.h
+//
+// Armazenamento dos pontos compartilhado pelas versões do K-Means (sequencial,
+// OpenMP, Pthreads, MPI e híbrida). Como kmeans_dataset.h, tudo é 'static
+// inline' para que cada programa continue sendo compilado a partir de um único
+// arquivo .c.
+//
+// As coordenadas ficam em um único vetor plano, coords[i * D + d] (exatamente o
+// layout de Dataset.coords), e os centroides em centroids[j * D + d]: não há
+// ponteiro por ponto, então a distância lê as coordenadas direto, sem a carga
+// dependente de 'point.coords'. O cluster de cada ponto fica em um vetor
+// separado, Labels, com o menor tipo que comporta K: uint8 (K <= 256), uint16
+// (K <= 65536) ou int32. Com K = 100, os rótulos de 1 milhão de pontos ocupam
+// 1 MB (cabem na L2), e a detecção de mudanças e a passada de atualização leem
+// só esse vetor compacto em vez de percorrer estruturas de 16 bytes.
+#ifndef KMEANS_LABELS_H
+#define KMEANS_LABELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  void* data;  // uint8_t, uint16_t ou int32_t, um por ponto
+  int bytes;   // 1, 2 ou 4
+} Labels;
+
+/**
+ * @brief Bytes por rótulo necessários para K clusters.
+ */
+static inline int labels_width(int K) {
+  if (K <= 256) return 1;
+  if (K <= 65536) return 2;
+  return 4;
+}
+
+/**
+ * @brief Bytes ocupados pelos rótulos de 'count' pontos com K clusters.
+ */
+static inline size_t labels_size(size_t count, int K) { return count * labels_width(K); }
+
+/**
+ * @brief Rótulos sobre 'data' (labels_size(count, K) bytes fornecidos pelo chamador).
+ */
+static inline Labels labels_wrap(void* data, int K) {
+  Labels l;
+  l.data = data;
+  l.bytes = labels_width(K);
+  return l;
+}
+
+static inline int label_get(const Labels* l, size_t i) {
+  switch (l->bytes) {
+    case 1:
+      return ((const uint8_t*)l->data)[i];
+    case 2:
+      return ((const uint16_t*)l->data)[i];
+    default:
+      return ((const int32_t*)l->data)[i];
+  }
+}
+
+static inline void label_set(Labels* l, size_t i, int cluster_id) {
+  switch (l->bytes) {
+    case 1:
+      ((uint8_t*)l->data)[i] = (uint8_t)cluster_id;
+      break;
+    case 2:
+      ((uint16_t*)l->data)[i] = (uint16_t)cluster_id;
+      break;
+    default:
+      ((int32_t*)l->data)[i] = cluster_id;
+  }
+}
+
+#endif  // KMEANS_LABELS_H
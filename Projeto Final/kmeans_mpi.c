@@ -0,0 +1,796 @@
+#define _GNU_SOURCE  // Necessário para MAP_POPULATE
+#include <limits.h>  // Para LLONG_MAX
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kmeans_dataset.h"  // Leitura dos datasets (texto ou binário .kmb)
+#include "kmeans_init.h"     // Inicialização kmeans++ / kmeans||
+#include "kmeans_labels.h"   // Coordenadas planas + rótulos compactos por ponto
+#include "kmeans_reduce.h"   // Acumuladores por thread e redução determinística
+
+/*
+ * O mesmo arquivo gera duas versões:
+ *  - MPI puro:        mpicc -o kmeans_mpi kmeans_mpi.c -O3
+ *  - MPI + OpenMP:    mpicc -o kmeans_hibrido kmeans_mpi.c -fopenmp -O3
+ * Na híbrida, a ideia é um processo por nó NUMA (mpirun --map-by numa
+ * --bind-to numa) com OMP_NUM_THREADS threads dentro dele. Sem -fopenmp as
+ * diretivas ficam fora da compilação (#ifdef _OPENMP) e cada processo tem uma
+ * única thread.
+ */
+#ifdef _OPENMP
+#include <omp.h>
+#else
+static inline int omp_get_thread_num(void) { return 0; }
+static inline int omp_get_num_threads(void) { return 1; }
+static inline int omp_get_max_threads(void) { return 1; }
+#endif
+
+// Tamanho da linha de cache: alinhamento do vetor de coordenadas locais
+#define CACHE_LINE 64
+
+// Forma de combinar as somas parciais entre os processos
+typedef enum {
+  COMM_BLOCKING,  // Um MPI_Allreduce ao final da atribuição (padrão)
+  COMM_HYBRID     // Duas reduções: a primeira metade dos pontos sobreposta à segunda
+} CommMode;
+
+// Pontos atribuídos entre chamadas a MPI_Testall, que fazem as reduções pendentes avançarem
+#define PROGRESS_POINTS 2048
+
+// Pontos de um processo: a faixa [first, first + count) dos M pontos do dataset
+typedef struct {
+  int* coords;     // count * D coordenadas
+  Labels labels;   // Cluster de cada ponto local (count), alocado por setup_local_points
+  long long first;  // Índice global do primeiro ponto
+  int count;
+} LocalPoints;
+
+// --- Funções Utilitárias ---
+
+/**
+ * @brief Calcula a distância Euclidiana ao quadrado entre dois pontos com coordenadas inteiras.
+ * Usa 'long long' para evitar overflow no cálculo da distância e da diferença.
+ * @return A distância Euclidiana ao quadrado como um long long.
+ */
+long long euclidean_dist_sq(const int* p1, const int* p2, int D) {
+  long long dist = 0;
+  for (int i = 0; i < D; i++) {
+    long long diff = (long long)p1[i] - p2[i];
+    dist += diff * diff;
+  }
+  return dist;
+}
+
+/**
+ * @brief Arredonda 'bytes' para o próximo múltiplo da linha de cache.
+ */
+size_t round_to_cache_line(size_t bytes) {
+  return (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+/**
+ * @brief Encerra todos os processos com uma mensagem (impressa só pelo rank 0).
+ * Deve ser chamada por todos os processos, com a mesma decisão.
+ */
+void fail_all(int rank, const char* message) {
+  if (rank == 0) fprintf(stderr, "%s\n", message);
+  MPI_Finalize();
+  exit(EXIT_FAILURE);
+}
+
+// --- Leitura Distribuída ---
+
+/*
+ * Cada processo lê apenas a sua parte do arquivo; o rank 0 nunca carrega o
+ * dataset inteiro.
+ *  - .kmb: o processo r fica com os pontos [M*r/P, M*(r+1)/P) e os lê com pread
+ *    no deslocamento correspondente. Funciona para qualquer M (as faixas
+ *    diferem em no máximo um ponto).
+ *  - Texto: o arquivo é dividido em P faixas de bytes que terminam em fim de
+ *    linha. Cada processo conta os inteiros da sua faixa; um Allgather das
+ *    contagens dá a posição de cada faixa entre os M * D inteiros, com as
+ *    mesmas regras de erro do fscanf. Se alguma faixa não começar em início de
+ *    ponto (linhas com número de valores diferente de D), todos recorrem à
+ *    leitura completa e ficam com a mesma faixa de índices do caso .kmb.
+ */
+
+/**
+ * @brief Faixa de pontos do processo 'rank' quando a divisão é por índice.
+ */
+void index_range(int M, int rank, int size, long long* first, int* count) {
+  *first = (long long)M * rank / size;
+  *count = (int)((long long)M * (rank + 1) / size - *first);
+}
+
+/**
+ * @brief Lê a faixa de índices do processo em um arquivo .kmb.
+ */
+void read_local_binary(const char* filename, int M, int D, int rank, int size, LocalPoints* lp) {
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  KmbHeader h;
+  if (fd < 0 || fstat(fd, &st) != 0 || pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+    fprintf(stderr, "Erro: Não foi possível ler o arquivo '%s'\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  validate_kmb_header(&h, st.st_size, filename, M, D);
+
+  index_range(M, rank, size, &lp->first, &lp->count);
+  lp->coords = (int*)malloc((size_t)lp->count * D * sizeof(int) + 1);
+  read_points_at(fd, h.header_size, D, lp->first, lp->count, lp->coords);
+  close(fd);
+}
+
+/**
+ * @brief Lê o dataset inteiro e copia a faixa de índices do processo (caminho
+ * de segurança para arquivos texto fora do formato de uma linha por ponto).
+ */
+void read_local_slice_of_full(const char* filename, int M, int D, int rank, int size, LocalPoints* lp) {
+  Dataset dataset;
+  load_dataset(filename, M, D, &dataset);
+  index_range(M, rank, size, &lp->first, &lp->count);
+  lp->coords = (int*)malloc((size_t)lp->count * D * sizeof(int) + 1);
+  memcpy(lp->coords, &dataset.coords[lp->first * D], (size_t)lp->count * D * sizeof(int));
+  free_dataset(&dataset);
+}
+
+/**
+ * @brief Início da faixa de bytes 'r' de um texto de 'bytes' bytes dividido em
+ * 'size' faixas: logo após o primeiro '\n' a partir de bytes*r/size.
+ */
+size_t text_boundary(const char* text, size_t bytes, int r, int size) {
+  if (r == 0) return 0;
+  if (r == size) return bytes;
+  size_t guess = bytes / size * r + bytes % size * r / size;
+  const char* newline = (const char*)memchr(text + guess, '\n', bytes - guess);
+  return newline != NULL ? (size_t)(newline - text) + 1 : bytes;
+}
+
+/**
+ * @brief Lê a faixa de bytes do processo em um arquivo texto.
+ */
+void read_local_text(const char* filename, int M, int D, int rank, int size, LocalPoints* lp) {
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "Erro: Não foi possível abrir o arquivo '%s'\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  const char* text = NULL;
+  if (S_ISREG(st.st_mode) && st.st_size > 0) {
+    text = (const char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (text == MAP_FAILED) text = NULL;
+  }
+  close(fd);
+
+  // Todos decidem juntos: sem mapeamento em algum processo, leitura completa
+  int mapped = text != NULL, all_mapped;
+  MPI_Allreduce(&mapped, &all_mapped, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (!all_mapped) {
+    if (text != NULL) munmap((void*)text, st.st_size);
+    read_local_slice_of_full(filename, M, D, rank, size, lp);
+    return;
+  }
+
+  size_t bytes = st.st_size;
+  TextChunk chunk = {0};
+  chunk.begin = text + text_boundary(text, bytes, rank, size);
+  chunk.end = text + text_boundary(text, bytes, rank + 1, size);
+  madvise((void*)chunk.begin, chunk.end - chunk.begin, MADV_SEQUENTIAL);
+  parse_text_chunk(&chunk, NULL, (size_t)-1);
+
+  // Contagem e erro de cada faixa, na ordem do arquivo
+  long long mine[2] = {(long long)chunk.count, chunk.malformed};
+  long long* all = (long long*)malloc(2 * size * sizeof(long long));
+  MPI_Allgather(mine, 2, MPI_LONG_LONG, all, 2, MPI_LONG_LONG, MPI_COMM_WORLD);
+
+  long long needed = (long long)M * D, offset = 0, my_offset = 0, my_take = 0;
+  int complete = 0, aligned = 1;
+  for (int r = 0; r < size && !complete; r++) {
+    long long take = all[2 * r] < needed - offset ? all[2 * r] : needed - offset;
+    if (take > 0 && (offset % D != 0 || take % D != 0)) aligned = 0;
+    if (r == rank) {
+      my_offset = offset;
+      my_take = take;
+    }
+    offset += take;
+    complete = offset == needed;
+    if (!complete && all[2 * r + 1]) break;  // token inválido antes dos M * D inteiros
+  }
+  free(all);
+
+  if (!complete) {
+    munmap((void*)text, bytes);
+    fail_all(rank, "Erro: Arquivo de dados mal formatado ou incompleto.");
+  }
+  if (!aligned) {
+    munmap((void*)text, bytes);
+    read_local_slice_of_full(filename, M, D, rank, size, lp);
+    return;
+  }
+
+  lp->first = my_offset / D;
+  lp->count = (int)(my_take / D);
+  lp->coords = (int*)malloc((size_t)my_take * sizeof(int) + 1);
+  parse_text_chunk(&chunk, lp->coords, (size_t)my_take);
+  munmap((void*)text, bytes);
+}
+
+/**
+ * @brief Lê os pontos do processo, detectando o formato pela assinatura.
+ */
+void read_local_points(const char* filename, int M, int D, int rank, int size, LocalPoints* lp) {
+  if (kmb_is_binary(filename)) {
+    read_local_binary(filename, M, D, rank, size, lp);
+  } else {
+    read_local_text(filename, M, D, rank, size, lp);
+  }
+}
+
+// --- Funções Principais do K-Means ---
+
+/**
+ * @brief Inicializa os centroides com os mesmos K pontos sorteados pela versão
+ * sequencial. Todos os processos fazem o mesmo sorteio; cada centroide é
+ * copiado pelo processo dono do ponto e os demais contribuem com zero, então
+ * um Allreduce de soma entrega os K centroides a todos.
+ */
+void initialize_centroids(const LocalPoints* lp, int* centroids, int M, int K, int D) {
+  srand(42);  // Semente fixa para reprodutibilidade
+
+  int* indices = (int*)malloc(M * sizeof(int));
+  for (int i = 0; i < M; i++) {
+    indices[i] = i;
+  }
+
+  for (int i = 0; i < M; i++) {
+    int j = rand() % M;
+    int temp = indices[i];
+    indices[i] = indices[j];
+    indices[j] = temp;
+  }
+
+  int* chosen = (int*)calloc((size_t)K * D, sizeof(int));
+  for (int i = 0; i < K; i++) {
+    if (indices[i] >= lp->first && indices[i] < lp->first + lp->count) {
+      memcpy(&chosen[i * D], &lp->coords[(indices[i] - lp->first) * D], D * sizeof(int));
+    }
+  }
+  MPI_Allreduce(chosen, centroids, K * D, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+  free(chosen);
+  free(indices);
+}
+
+// --- Inicialização kmeans++ / kmeans|| Distribuída ---
+
+/*
+ * Os mesmos sorteios de kmeans_init.h, com as somas de d(x)² e os candidatos
+ * combinados entre os processos. Os sorteios usam índices globais, os totais
+ * são somados em ordem de processo e os candidatos são reunidos nessa mesma
+ * ordem (a dos índices globais), então os centros são idênticos aos da versão
+ * sequencial para qualquer número de processos.
+ */
+
+/**
+ * @brief Reúne os totais locais (128 bits, enviados como duas palavras);
+ * prefix[r] recebe a soma dos processos anteriores a r e prefix[size], o total.
+ */
+void gather_prefix_totals(unsigned __int128 local, int size, unsigned __int128* prefix) {
+  unsigned long long mine[2] = {(unsigned long long)local, (unsigned long long)(local >> 64)};
+  unsigned long long* all = (unsigned long long*)malloc(2 * size * sizeof(unsigned long long));
+  MPI_Allgather(mine, 2, MPI_UNSIGNED_LONG_LONG, all, 2, MPI_UNSIGNED_LONG_LONG, MPI_COMM_WORLD);
+  prefix[0] = 0;
+  for (int r = 0; r < size; r++) {
+    prefix[r + 1] = prefix[r] + (((unsigned __int128)all[2 * r + 1] << 64) | all[2 * r]);
+  }
+  free(all);
+}
+
+/**
+ * @brief Copia para 'out' o ponto de índice global 'index', enviado pelo
+ * processo dono. 'ranges' tem (primeiro índice, quantidade) de cada processo.
+ */
+void fetch_point(const LocalPoints* lp, const long long* ranges, int rank, int size, long long index, int D,
+                 int* out) {
+  int owner = 0;
+  while (owner < size - 1 && !(index >= ranges[2 * owner] && index < ranges[2 * owner] + ranges[2 * owner + 1])) {
+    owner++;
+  }
+  if (rank == owner) {
+    memcpy(out, &lp->coords[(index - lp->first) * D], D * sizeof(int));
+  }
+  MPI_Bcast(out, D, MPI_INT, owner, MPI_COMM_WORLD);
+}
+
+/**
+ * @brief Copia para 'out' o ponto em que a soma acumulada global de min_dist
+ * passa de 'target' (0 <= target < prefix[size]).
+ */
+void fetch_weighted_point(const LocalPoints* lp, const long long* min_dist, const unsigned __int128* prefix,
+                          int rank, int size, unsigned __int128 target, int D, int* out) {
+  int owner = 0;
+  while (owner < size - 1 && target >= prefix[owner + 1]) {
+    owner++;
+  }
+  if (rank == owner) {
+    int i = init_pick_weighted(min_dist, lp->count, target - prefix[owner]);
+    memcpy(out, &lp->coords[(size_t)i * D], D * sizeof(int));
+  }
+  MPI_Bcast(out, D, MPI_INT, owner, MPI_COMM_WORLD);
+}
+
+/**
+ * @brief k-means++ distribuído: K rodadas, cada uma com a atualização local
+ * de d(x)² (em paralelo na versão híbrida) e um Allgather de totais.
+ */
+void initialize_centroids_kmeanspp(const LocalPoints* lp, const long long* ranges, int M, int K, int D, int rank,
+                                   int size, int* centers) {
+  long long* min_dist = init_alloc_min_dist(lp->count + 1);  // +1: processos sem pontos
+  unsigned __int128* prefix = (unsigned __int128*)malloc((size + 1) * sizeof(unsigned __int128));
+
+  fetch_point(lp, ranges, rank, size, (long long)init_uniform(INIT_SEED, INIT_STREAM_CENTER, 0, 0, M), D, centers);
+  for (int k = 1; k < K; k++) {
+    unsigned __int128 local = init_update_min_dist(lp->coords, lp->count, D, &centers[(size_t)(k - 1) * D], 1,
+                                                   k - 1, min_dist, NULL);
+    gather_prefix_totals(local, size, prefix);
+    if (prefix[size] == 0) {
+      long long index = (long long)init_uniform(INIT_SEED, INIT_STREAM_CENTER, k, 0, M);
+      fetch_point(lp, ranges, rank, size, index, D, &centers[(size_t)k * D]);
+    } else {
+      unsigned __int128 target = init_uniform(INIT_SEED, INIT_STREAM_CENTER, k, 1, prefix[size]);
+      fetch_weighted_point(lp, min_dist, prefix, rank, size, target, D, &centers[(size_t)k * D]);
+    }
+  }
+
+  free(prefix);
+  free(min_dist);
+}
+
+/**
+ * @brief k-means|| distribuído: cada rodada sorteia candidatos localmente e os
+ * reúne com um Allgatherv; os pesos são somados com um Allreduce e a redução
+ * a K centros (pequena) é repetida igualmente em todos os processos.
+ */
+void initialize_centroids_kmeans_parallel(const LocalPoints* lp, const long long* ranges, int M, int K, int D,
+                                          int rank, int size, int* centers) {
+  long long* min_dist = init_alloc_min_dist(lp->count + 1);  // +1: processos sem pontos
+  int* nearest = (int*)malloc((lp->count + 1) * sizeof(int));
+  int* selected = (int*)malloc((lp->count + 1) * sizeof(int));
+  int* send = (int*)malloc(((size_t)lp->count + 1) * D * sizeof(int));
+  int* recv_counts = (int*)malloc(size * sizeof(int));
+  int* displs = (int*)malloc(size * sizeof(int));
+  unsigned __int128* prefix = (unsigned __int128*)malloc((size + 1) * sizeof(unsigned __int128));
+  int* cands = (int*)malloc((size_t)D * sizeof(int));
+  if (nearest == NULL || selected == NULL || send == NULL || recv_counts == NULL || displs == NULL ||
+      prefix == NULL || cands == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar a inicialização dos centroides.\n");
+    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+  }
+
+  fetch_point(lp, ranges, rank, size, (long long)init_uniform(INIT_SEED, INIT_STREAM_CENTER, 0, 0, M), D, cands);
+  int C = 1;
+  gather_prefix_totals(init_update_min_dist(lp->coords, lp->count, D, cands, 1, 0, min_dist, nearest), size,
+                       prefix);
+
+  for (int round = 0; round < INIT_ROUNDS && prefix[size] > 0; round++) {
+    int n = init_sample_round(min_dist, lp->count, lp->first, prefix[size], (long long)INIT_OVERSAMPLING * K,
+                              INIT_SEED, round, selected);
+    for (int s = 0; s < n; s++) {
+      memcpy(&send[(size_t)s * D], &lp->coords[(size_t)selected[s] * D], D * sizeof(int));
+    }
+
+    // Candidatos de todos os processos, na ordem dos índices globais
+    MPI_Allgather(&n, 1, MPI_INT, recv_counts, 1, MPI_INT, MPI_COMM_WORLD);
+    int added = 0;
+    for (int r = 0; r < size; r++) {
+      displs[r] = added * D;
+      added += recv_counts[r];
+      recv_counts[r] *= D;
+    }
+    cands = (int*)realloc(cands, (size_t)(C + added) * D * sizeof(int));
+    if (cands == NULL) {
+      fprintf(stderr, "Erro: Falha ao alocar a inicialização dos centroides.\n");
+      MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Allgatherv(send, n * D, MPI_INT, &cands[(size_t)C * D], recv_counts, displs, MPI_INT, MPI_COMM_WORLD);
+
+    unsigned __int128 local = init_update_min_dist(lp->coords, lp->count, D, &cands[(size_t)C * D], added, C,
+                                                   min_dist, nearest);
+    gather_prefix_totals(local, size, prefix);
+    C += added;
+  }
+
+  long long* weights = (long long*)calloc(C, sizeof(long long));
+  for (int i = 0; i < lp->count; i++) {
+    weights[nearest[i]]++;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, weights, C, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  init_reduce_candidates(cands, weights, C, D, K, INIT_SEED, centers);
+
+  free(weights);
+  free(cands);
+  free(prefix);
+  free(displs);
+  free(recv_counts);
+  free(send);
+  free(selected);
+  free(nearest);
+  free(min_dist);
+}
+
+/**
+ * @brief Executa kmeans++ ou kmeans|| entre todos os processos; o processo 0
+ * relata o tempo gasto em stderr.
+ */
+void initialize_centroids_with(InitStrategy init, const LocalPoints* lp, int M, int K, int D, int rank, int size,
+                               int* centroid_coords) {
+  double start = MPI_Wtime();
+  long long mine[2] = {lp->first, lp->count};
+  long long* ranges = (long long*)malloc(2 * size * sizeof(long long));
+  MPI_Allgather(mine, 2, MPI_LONG_LONG, ranges, 2, MPI_LONG_LONG, MPI_COMM_WORLD);
+
+  if (init == INIT_KMEANSPP) {
+    initialize_centroids_kmeanspp(lp, ranges, M, K, D, rank, size, centroid_coords);
+  } else {
+    initialize_centroids_kmeans_parallel(lp, ranges, M, K, D, rank, size, centroid_coords);
+  }
+
+  free(ranges);
+  if (rank == 0) {
+    fprintf(stderr, "Inicialização %s: %.3f s\n", init_name(init), MPI_Wtime() - start);
+  }
+}
+
+/**
+ * @brief Atribui os pontos e soma cada um no acumulador do seu cluster (sem
+ * zerá-lo). 'acc' segue o layout de kmeans_reduce.h (K * D somas seguidas de K
+ * contagens), para que as duas partes sigam em uma única redução.
+ */
+void accumulate_assigned(const int* coords, Labels* labels, int begin, int end, const int* centroids, int K, int D,
+                         long long* acc) {
+  for (int i = begin; i < end; i++) {
+    const int* point = &coords[(size_t)i * D];
+    long long min_dist = LLONG_MAX;
+    int best_cluster = -1;
+
+    for (int j = 0; j < K; j++) {
+      long long dist = euclidean_dist_sq(point, &centroids[j * D], D);
+      if (dist < min_dist) {
+        min_dist = dist;
+        best_cluster = j;
+      }
+    }
+    label_set(labels, i, best_cluster);
+    acc_add_point(acc, point, best_cluster, K, D);
+  }
+}
+
+// --- Threads Dentro do Processo e Posicionamento NUMA ---
+
+/*
+ * Cada thread fica com uma fatia fixa [count*t/T, count*(t+1)/T) dos pontos do
+ * processo. A fatia é copiada para o vetor definitivo pela própria thread
+ * (primeiro toque), então as páginas dela ficam no nó NUMA em que a thread
+ * roda, e todas as iterações percorrem exatamente a mesma fatia. Os
+ * acumuladores privados também são zerados pela thread dona. O runtime pode
+ * criar uma equipe menor que a pedida (OMP_DYNAMIC, OMP_THREAD_LIMIT): a
+ * thread tid fica então com as fatias tid, tid + equipe, ..., de modo que
+ * todas as fatias (e suas áreas de acumulador) continuam sendo processadas.
+ */
+
+/**
+ * @brief Fatia de pontos da thread 'tid' entre 'num_threads'.
+ */
+void thread_slice(int count, int tid, int num_threads, int* begin, int* end) {
+  *begin = (int)((long long)count * tid / num_threads);
+  *end = (int)((long long)count * (tid + 1) / num_threads);
+}
+
+/**
+ * @brief Aloca os rótulos dos pontos do processo. Na versão com OpenMP, as
+ * coordenadas são recopiadas em paralelo, cada thread tocando primeiro a sua
+ * fatia de coordenadas e de rótulos (fora da medição de tempo).
+ */
+void setup_local_points(LocalPoints* lp, int K, int D, int num_threads) {
+  lp->labels = labels_wrap(malloc(labels_size((size_t)lp->count + 1, K)), K);
+  int* coords = lp->coords;
+#ifdef _OPENMP
+  coords = (int*)aligned_alloc(CACHE_LINE, round_to_cache_line((size_t)lp->count * D * sizeof(int) + 1));
+  if (coords == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar os pontos do processo.\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+  {
+    int team = omp_get_num_threads();
+    for (int t = omp_get_thread_num(); t < num_threads; t += team) {
+      int begin, end;
+      thread_slice(lp->count, t, num_threads, &begin, &end);
+      if (coords != lp->coords) {
+        memcpy(&coords[(size_t)begin * D], &lp->coords[(size_t)begin * D], (size_t)(end - begin) * D * sizeof(int));
+      }
+      for (int i = begin; i < end; i++) {
+        label_set(&lp->labels, i, 0);
+      }
+    }
+  }
+
+  if (coords != lp->coords) {
+    free(lp->coords);
+    lp->coords = coords;
+  }
+}
+
+// --- Redução e Sobreposição de Comunicação e Computação ---
+
+/*
+ * As somas seguem o caminho thread -> processo -> global: cada thread soma
+ * nos seus acumuladores privados, as áreas das threads são combinadas por uma
+ * redução em árvore (log2(T) níveis separados por barreiras) e a thread 0
+ * entrega o total do processo ao MPI (MPI_THREAD_FUNNELED).
+ *
+ * Com --comm=hybrid a fatia de cada thread é dividida em dois grupos de
+ * pontos, cada um com sua redução do acumulador inteiro. A redução do
+ * primeiro segue pela rede enquanto o segundo é calculado (chamadas periódicas
+ * a MPI_Testall garantem o progresso); o volume dobra. Os dois totais são
+ * somados sempre na mesma ordem, então o resultado não depende de qual
+ * redução terminou antes; como as somas são inteiras, ele é idêntico ao do
+ * Allreduce único. Um ponto pode cair em qualquer cluster, então não há como
+ * esconder a redução atrás da atribuição sem mandar mais de um acumulador.
+ */
+
+typedef struct {
+  CommMode mode;
+  int num_groups;        // Grupos de pontos, cada um com sua redução (2 no modo hybrid, senão 1)
+  size_t len;            // K * D somas + K contagens
+  AccumulatorSet threads;  // Áreas privadas das threads
+  long long* partial;    // num_groups totais do processo (buffers de envio)
+  long long* reduced;    // num_groups totais globais
+  MPI_Request* requests;
+} CommState;
+
+void comm_alloc(CommState* cs, CommMode mode, int num_threads, int K, int D) {
+  cs->mode = mode;
+  cs->num_groups = mode == COMM_HYBRID ? 2 : 1;
+  cs->len = acc_len(K, D);
+  acc_set_alloc(&cs->threads, num_threads, K, D);
+  cs->partial = (long long*)malloc(cs->num_groups * cs->len * sizeof(long long));
+  cs->reduced = (long long*)malloc(cs->num_groups * cs->len * sizeof(long long));
+  cs->requests = (MPI_Request*)malloc(cs->num_groups * sizeof(MPI_Request));
+  if (cs->partial == NULL || cs->reduced == NULL || cs->requests == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar os acumuladores.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+void comm_free(CommState* cs) {
+  acc_set_free(&cs->threads);
+  free(cs->partial);
+  free(cs->reduced);
+  free(cs->requests);
+}
+
+/**
+ * @brief Redução em árvore das áreas privadas, chamada por todas as threads da
+ * região paralela. Ao retornar (após a barreira), a área 0 contém o total.
+ */
+void tree_reduce_threads(const CommState* cs, int tid, int team) {
+  // Todas as threads terminaram de somar antes do primeiro nível
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+  for (int step = 1; step < cs->threads.num_parts; step *= 2) {
+    for (int p = tid; p < cs->threads.num_parts; p += team) {
+      acc_tree_step(&cs->threads, p, step);
+    }
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+  }
+}
+
+/**
+ * @brief Executa as I iterações em uma única região paralela. Todos os
+ * processos fazem o mesmo número de reduções (mesmo com fatias vazias), então
+ * elas casam entre eles.
+ */
+void run_kmeans(LocalPoints* lp, int* centroids, int K, int D, int I, CommState* cs) {
+  const int T = cs->threads.num_parts;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(T)
+#endif
+  {
+    int tid = omp_get_thread_num();
+    int team = omp_get_num_threads();  // Pode ser menor que T: ver setup_local_points
+
+    for (int iter = 0; iter < I; iter++) {
+      int launched = 0;  // Reduções não bloqueantes já iniciadas (só a thread 0 usa)
+
+      for (int g = 0; g < cs->num_groups; g++) {
+        // Fatias tid, tid + team, ...: cada uma soma na área de mesmo índice
+        for (int t = tid; t < T; t += team) {
+          long long* part = acc_part(&cs->threads, t);
+          int slice_begin, slice_end;
+          thread_slice(lp->count, t, T, &slice_begin, &slice_end);
+          int slice = slice_end - slice_begin;
+          int p_begin = slice_begin + (int)((long long)slice * g / cs->num_groups);
+          int p_end = slice_begin + (int)((long long)slice * (g + 1) / cs->num_groups);
+          acc_part_clear(&cs->threads, t);
+
+          for (int p = p_begin; p < p_end; p += PROGRESS_POINTS) {
+            int n = p_end - p < PROGRESS_POINTS ? p_end - p : PROGRESS_POINTS;
+            accumulate_assigned(lp->coords, &lp->labels, p, p + n, centroids, K, D, part);
+            if (tid == 0 && launched > 0) {
+              int done;
+              MPI_Testall(launched, cs->requests, &done, MPI_STATUSES_IGNORE);
+            }
+          }
+        }
+
+        tree_reduce_threads(cs, tid, team);
+
+        if (tid == 0) {
+          long long* group_total = &cs->partial[g * cs->len];
+          memcpy(group_total, acc_part(&cs->threads, 0), cs->len * sizeof(long long));
+          if (cs->mode == COMM_BLOCKING) {
+            // Somas e contagens de todos os processos em uma única redução
+            MPI_Allreduce(group_total, cs->reduced, (int)cs->len, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+          } else {
+            MPI_Iallreduce(group_total, &cs->reduced[g * cs->len], (int)cs->len, MPI_LONG_LONG, MPI_SUM,
+                           MPI_COMM_WORLD, &cs->requests[g]);
+            launched++;
+          }
+        }
+      }
+
+      if (tid == 0) {
+        if (launched > 0) MPI_Waitall(launched, cs->requests, MPI_STATUSES_IGNORE);
+        for (int g = 1; g < cs->num_groups; g++) {
+          acc_add(cs->reduced, &cs->reduced[g * cs->len], 0, cs->len);
+        }
+        acc_centroids(cs->reduced, centroids, K, D);
+      }
+      // Os novos centroides ficam visíveis para todas as threads
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+    }
+  }
+}
+
+/**
+ * @brief Calcula e imprime o tempo de execução e o checksum final.
+ * A saída é formatada para ser facilmente lida por scripts:
+ * Linha 1: Tempo de execução em segundos (double)
+ * Linha 2: Checksum final (long long)
+ */
+void print_time_and_checksum(const int* centroids, int K, int D, double exec_time) {
+  long long checksum = 0;
+  for (int i = 0; i < K; i++) {
+    for (int j = 0; j < D; j++) {
+      checksum += centroids[i * D + j];
+    }
+  }
+  // Saída formatada para o avaliador
+  printf("%lf\n", exec_time);
+  printf("%lld\n", checksum);
+}
+
+/**
+ * @brief Lê as opções extras que seguem os argumentos obrigatórios.
+ * @return 1 em caso de sucesso, 0 se alguma opção for inválida.
+ */
+int parse_options(int argc, char* argv[], int first, CommMode* mode, InitStrategy* init) {
+  *mode = COMM_BLOCKING;
+  *init = INIT_RANDOM;
+  for (int i = first; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--comm=blocking") == 0) {
+      *mode = COMM_BLOCKING;
+    } else if (strcmp(arg, "--comm=hybrid") == 0) {
+      *mode = COMM_HYBRID;
+    } else if (strncmp(arg, "--init=", 7) == 0 && init_parse(arg + 7, init)) {
+      // estratégia de inicialização reconhecida
+    } else {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// --- Função Principal ---
+
+int main(int argc, char* argv[]) {
+  int rank, size, provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  // Validação e leitura dos argumentos de linha de comando
+  CommMode mode;
+  InitStrategy init;
+  if (argc < 6 || !parse_options(argc, argv, 6, &mode, &init)) {
+    if (rank == 0) {
+      fprintf(stderr,
+              "Uso: mpirun -np <P> %s <arquivo_dados> <M_pontos> <D_dimensoes> <K_clusters> <I_iteracoes> [opções]\n",
+              argv[0]);
+      fprintf(stderr, "Opções:\n");
+      fprintf(stderr, "  --comm=blocking|hybrid          Redução única (padrão), ou duas com a da primeira metade\n");
+      fprintf(stderr, "                                  dos pontos sobreposta ao cálculo (volume dobrado)\n");
+      fprintf(stderr, "  --init=random|kmeans++|kmeans|| Centroides iniciais (padrão: random, o sorteio original)\n");
+    }
+    MPI_Finalize();
+    return EXIT_FAILURE;
+  }
+
+  const char* filename = argv[1];  // Nome do arquivo de dados
+  const int M = atoi(argv[2]);     // Número de pontos
+  const int D = atoi(argv[3]);     // Número de dimensões
+  const int K = atoi(argv[4]);     // Número de clusters
+  const int I = atoi(argv[5]);     // Número de iterações
+
+  if (M <= 0 || D <= 0 || K <= 0 || I <= 0 || K > M) {
+    fail_all(rank, "Erro nos parâmetros. Verifique se M,D,K,I > 0 e K <= M.");
+  }
+
+  // --- Preparação (Fora da medição de tempo) ---
+  int T = omp_get_max_threads();  // Threads por processo (OMP_NUM_THREADS na versão híbrida)
+  if (T > 1 && provided < MPI_THREAD_FUNNELED) {
+    // Sem MPI_THREAD_FUNNELED, regiões paralelas entre chamadas MPI não são permitidas
+    if (rank == 0) {
+      fprintf(stderr, "Aviso: a biblioteca MPI não oferece MPI_THREAD_FUNNELED; usando 1 thread por processo.\n");
+    }
+    T = 1;
+#ifdef _OPENMP
+    omp_set_num_threads(1);  // Vale também para as regiões da inicialização (kmeans_init.h)
+#endif
+  }
+  LocalPoints lp;
+  read_local_points(filename, M, D, rank, size, &lp);
+
+  int* centroids = (int*)malloc((size_t)K * D * sizeof(int));
+  setup_local_points(&lp, K, D, T);
+  CommState cs;
+  // ... (verificação de alocação) ...
+  if (init == INIT_RANDOM) {
+    initialize_centroids(&lp, centroids, M, K, D);
+  } else {
+    initialize_centroids_with(init, &lp, M, K, D, rank, size, centroids);
+  }
+  comm_alloc(&cs, mode, T, K, D);
+
+  // --- Medição de Tempo do Algoritmo Principal ---
+  MPI_Barrier(MPI_COMM_WORLD);
+  double start = MPI_Wtime();  // Inicia o cronômetro
+
+  // Laço principal do K-Means (A única parte que será medida)
+  run_kmeans(&lp, centroids, K, D, I, &cs);
+
+  double time_taken = MPI_Wtime() - start;  // Para o cronômetro
+
+  // --- Apresentação dos Resultados ---
+  int min_count, max_count;
+  MPI_Reduce(&lp.count, &min_count, 1, MPI_INT, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&lp.count, &max_count, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+  if (rank == 0) {
+    print_time_and_checksum(centroids, K, D, time_taken);
+    fprintf(stderr, "Processos MPI: %d x %d threads (%d a %d pontos por processo)\n", size, T, min_count,
+            max_count);
+  }
+
+  // --- Limpeza ---
+  free(lp.coords);
+  free(lp.labels.data);
+  free(centroids);
+  comm_free(&cs);
+
+  MPI_Finalize();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,328 @@
+#define _GNU_SOURCE  // Necessário para CLOCK_MONOTONIC e MAP_POPULATE
+#include <limits.h>  // Para LLONG_MAX
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>  // Header correto para clock_gettime e struct timespec
+
+#include "kmeans_dataset.h"  // Leitura dos datasets (texto ou binário .kmb)
+#include "kmeans_init.h"     // Inicialização kmeans++ / kmeans|| (laços paralelos com OpenMP)
+#include "kmeans_labels.h"   // Coordenadas planas + rótulos compactos por ponto
+#include "kmeans_reduce.h"   // Acumuladores por thread e redução determinística
+
+// O que fazer com um cluster que ficou sem pontos na atribuição (--empty)
+typedef enum {
+  EMPTY_KEEP,      // Mantém o centroide anterior (padrão)
+  EMPTY_FARTHEST,  // Recebe o ponto mais distante do seu centroide
+  EMPTY_SPLIT      // Recebe o ponto mais distante do maior cluster, dividindo-o
+} EmptyPolicy;
+
+// Ponto mais distante de cada cluster, uma linha de K entradas por thread
+typedef struct {
+  EmptyPolicy policy;
+  long long* far_dist;  // T * K: maior distância mínima vista pela thread em cada cluster
+  int* far_point;       // T * K: ponto que a atingiu (-1 = nenhum)
+  long long relocated;  // Clusters vazios que receberam um ponto
+} EmptyTracker;
+
+// --- Funções Utilitárias ---
+
+/**
+ * @brief Calcula a distância Euclidiana ao quadrado entre dois pontos com coordenadas inteiras.
+ * Usa 'long long' para evitar overflow no cálculo da distância e da diferença.
+ * @return A distância Euclidiana ao quadrado como um long long.
+ */
+long long euclidean_dist_sq(const int* p1, const int* p2, int D) {
+  long long dist = 0;
+  for (int i = 0; i < D; i++) {
+    long long diff = (long long)p1[i] - p2[i];
+    dist += diff * diff;
+  }
+  return dist;
+}
+
+// --- Acumuladores Privados por Thread ---
+
+/*
+ * Cada thread soma os pontos que atribuiu na sua área de um AccumulatorSet
+ * (kmeans_reduce.h), sem atomics nem regiões críticas. Ao final da iteração,
+ * as áreas são combinadas por uma redução em árvore: em cada nível, a thread t
+ * soma a área t + passo na sua, e após log2(T) níveis o total está na área 0.
+ * O runtime pode criar uma equipe menor que a pedida (OMP_DYNAMIC,
+ * OMP_THREAD_LIMIT, paralelismo aninhado): por isso cada thread cuida das
+ * áreas tid, tid + equipe, ..., e todas as num_parts áreas são zeradas e
+ * combinadas qualquer que seja o tamanho da equipe.
+ */
+
+/**
+ * @brief Redução em árvore das áreas privadas, chamada por todas as threads da
+ * região paralela logo após o laço 'for' (cuja barreira implícita garante que
+ * todas terminaram de somar). Ao retornar, a área 0 contém o total.
+ */
+void tree_reduce_accumulators(const AccumulatorSet* acc, int tid, int team) {
+  for (int step = 1; step < acc->num_parts; step *= 2) {
+    for (int p = tid; p < acc->num_parts; p += team) {
+      acc_tree_step(acc, p, step);
+    }
+#pragma omp barrier
+  }
+}
+
+// --- Clusters Vazios ---
+
+/*
+ * Com --empty=farthest|split, cada thread registra, durante a própria
+ * atribuição, o ponto mais distante de cada cluster na sua linha de
+ * EmptyTracker. Depois da redução dos acumuladores, a thread do 'single'
+ * combina as linhas em ordem crescente de thread (empate fica com a menor,
+ * que tem os menores índices no escalonamento estático) e move os pontos
+ * escolhidos no acumulador total, antes do cálculo dos centroides. Assim o
+ * resultado é o mesmo da versão sequencial para qualquer número de threads.
+ */
+
+void reset_farthest(EmptyTracker* empty, int tid, int K) {
+  for (int j = 0; j < K; j++) {
+    empty->far_dist[(size_t)tid * K + j] = 0;  // Pontos sobre o próprio centroide nunca são doados
+    empty->far_point[(size_t)tid * K + j] = -1;
+  }
+}
+
+/**
+ * @brief Combina as linhas das threads na linha 0 e aplica a política às
+ * somas e contagens de 'total' (a área 0 do AccumulatorSet já reduzida).
+ */
+void relocate_empty_clusters(EmptyTracker* empty, const int* coords, Labels* labels, long long* total, int K, int D,
+                             int T) {
+  long long* far_dist = empty->far_dist;
+  int* far_point = empty->far_point;
+  for (int t = 1; t < T; t++) {
+    for (int c = 0; c < K; c++) {
+      if (far_point[(size_t)t * K + c] >= 0 && far_dist[(size_t)t * K + c] > far_dist[c]) {
+        far_dist[c] = far_dist[(size_t)t * K + c];
+        far_point[c] = far_point[(size_t)t * K + c];
+      }
+    }
+  }
+
+  long long* counts = acc_counts(total, K, D);
+  for (int e = 0; e < K; e++) {
+    if (counts[e] > 0) continue;
+
+    int donor = -1;
+    for (int c = 0; c < K; c++) {
+      if (far_point[c] < 0 || counts[c] < 2) continue;
+      if (donor < 0 ||
+          (empty->policy == EMPTY_FARTHEST ? far_dist[c] > far_dist[donor] : counts[c] > counts[donor])) {
+        donor = c;
+      }
+    }
+    if (donor < 0) break;  // Nenhum cluster pode doar nesta iteração
+
+    const int* point = &coords[(size_t)far_point[donor] * D];
+    counts[donor]--;
+    counts[e] = 1;
+    for (int j = 0; j < D; j++) {
+      total[(size_t)donor * D + j] -= point[j];
+      total[(size_t)e * D + j] = point[j];
+    }
+    label_set(labels, far_point[donor], e);
+    far_point[donor] = -1;
+    empty->relocated++;
+  }
+}
+
+// --- Funções Principais do K-Means ---
+
+/**
+ * @brief Inicializa os centroides escolhendo K pontos aleatórios do dataset
+ * (mesmo sorteio da versão sequencial).
+ */
+void initialize_centroids(const int* coords, int* centroids, int M, int K, int D) {
+  srand(42);  // Semente fixa para reprodutibilidade
+
+  int* indices = (int*)malloc(M * sizeof(int));
+  for (int i = 0; i < M; i++) {
+    indices[i] = i;
+  }
+
+  for (int i = 0; i < M; i++) {
+    int j = rand() % M;
+    int temp = indices[i];
+    indices[i] = indices[j];
+    indices[j] = temp;
+  }
+
+  for (int i = 0; i < K; i++) {
+    memcpy(&centroids[i * D], &coords[(size_t)indices[i] * D], D * sizeof(int));
+  }
+
+  free(indices);
+}
+
+/**
+ * @brief Executa as I iterações do K-Means em uma única região paralela.
+ * Atribuição: laço 'for' com escalonamento estático, em que cada thread atribui
+ * seus pontos e já os soma nos seus acumuladores privados (o ponto ainda está
+ * na cache). Atualização: redução em árvore dos acumuladores e cálculo dos
+ * centroides por uma única thread; a barreira implícita do 'single' garante que
+ * todas vejam os novos centroides na iteração seguinte. Com 'empty' não nulo,
+ * a atribuição também registra o ponto mais distante de cada cluster.
+ */
+void run_kmeans(const int* coords, Labels* labels, int* centroids, int M, int K, int D, int I, AccumulatorSet* acc,
+                EmptyTracker* empty) {
+#pragma omp parallel num_threads(acc->num_parts)
+  {
+    int tid = omp_get_thread_num();
+    int team = omp_get_num_threads();  // Pode ser menor que acc->num_parts
+    long long* mine = acc_part(acc, tid);
+    long long* far_dist = empty != NULL ? &empty->far_dist[(size_t)tid * K] : NULL;
+    int* far_point = empty != NULL ? &empty->far_point[(size_t)tid * K] : NULL;
+
+    for (int iter = 0; iter < I; iter++) {
+      for (int p = tid; p < acc->num_parts; p += team) {
+        acc_part_clear(acc, p);
+        if (empty != NULL) reset_farthest(empty, p, K);
+      }
+
+#pragma omp for schedule(static)
+      for (int i = 0; i < M; i++) {
+        const int* point = &coords[(size_t)i * D];
+        long long min_dist = LLONG_MAX;
+        int best_cluster = -1;
+
+        for (int j = 0; j < K; j++) {
+          long long dist = euclidean_dist_sq(point, &centroids[j * D], D);
+          if (dist < min_dist) {
+            min_dist = dist;
+            best_cluster = j;
+          }
+        }
+        label_set(labels, i, best_cluster);
+        acc_add_point(mine, point, best_cluster, K, D);
+        if (far_dist != NULL && min_dist > far_dist[best_cluster]) {
+          far_dist[best_cluster] = min_dist;
+          far_point[best_cluster] = i;
+        }
+      }
+
+      tree_reduce_accumulators(acc, tid, team);
+
+#pragma omp single
+      {
+        if (empty != NULL) relocate_empty_clusters(empty, coords, labels, acc_part(acc, 0), K, D, acc->num_parts);
+        acc_centroids(acc_part(acc, 0), centroids, K, D);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Calcula e imprime o tempo de execução e o checksum final.
+ * A saída é formatada para ser facilmente lida por scripts:
+ * Linha 1: Tempo de execução em segundos (double)
+ * Linha 2: Checksum final (long long)
+ */
+void print_time_and_checksum(const int* centroids, int K, int D, double exec_time) {
+  long long checksum = 0;
+  for (int i = 0; i < K; i++) {
+    for (int j = 0; j < D; j++) {
+      checksum += centroids[i * D + j];
+    }
+  }
+  // Saída formatada para o avaliador
+  printf("%lf\n", exec_time);
+  printf("%lld\n", checksum);
+}
+
+// --- Função Principal ---
+
+int main(int argc, char* argv[]) {
+  // Validação e leitura dos argumentos de linha de comando
+  InitStrategy init = INIT_RANDOM;
+  EmptyPolicy policy = EMPTY_KEEP;
+  int bad_args = argc < 6;
+  for (int a = 6; a < argc && !bad_args; a++) {
+    if (strncmp(argv[a], "--init=", 7) == 0) {
+      bad_args = !init_parse(argv[a] + 7, &init);
+    } else if (strcmp(argv[a], "--empty=keep") == 0) {
+      policy = EMPTY_KEEP;
+    } else if (strcmp(argv[a], "--empty=farthest") == 0) {
+      policy = EMPTY_FARTHEST;
+    } else if (strcmp(argv[a], "--empty=split") == 0) {
+      policy = EMPTY_SPLIT;
+    } else {
+      bad_args = 1;
+    }
+  }
+  if (bad_args) {
+    fprintf(stderr,
+            "Uso: %s <arquivo_dados> <M_pontos> <D_dimensoes> <K_clusters> <I_iteracoes> "
+            "[--init=random|kmeans++|kmeans||] [--empty=keep|farthest|split]\n",
+            argv[0]);
+    fprintf(stderr, "O número de threads vem de OMP_NUM_THREADS.\n");
+    return EXIT_FAILURE;
+  }
+
+  const char* filename = argv[1];  // Nome do arquivo de dados
+  const int M = atoi(argv[2]);     // Número de pontos
+  const int D = atoi(argv[3]);     // Número de dimensões
+  const int K = atoi(argv[4]);     // Número de clusters
+  const int I = atoi(argv[5]);     // Número de iterações
+
+  if (M <= 0 || D <= 0 || K <= 0 || I <= 0 || K > M) {
+    fprintf(stderr, "Erro nos parâmetros. Verifique se M,D,K,I > 0 e K <= M.\n");
+    return EXIT_FAILURE;
+  }
+
+  // --- Alocação de Memória ---
+  Dataset dataset = {0};
+  int* centroids = (int*)malloc((size_t)K * D * sizeof(int));
+  Labels labels = labels_wrap(malloc(labels_size(M, K)), K);
+  AccumulatorSet acc;
+  // ... (verificação de alocação) ...
+
+  // --- Preparação (Fora da medição de tempo) ---
+  load_dataset(filename, M, D, &dataset);
+  if (init == INIT_RANDOM) {
+    initialize_centroids(dataset.coords, centroids, M, K, D);
+  } else {
+    init_centers(init, dataset.coords, M, D, K, centroids);
+  }
+  acc_set_alloc(&acc, omp_get_max_threads(), K, D);
+  EmptyTracker empty = {policy, NULL, NULL, 0};
+  if (policy != EMPTY_KEEP) {
+    empty.far_dist = (long long*)malloc((size_t)acc.num_parts * K * sizeof(long long));
+    empty.far_point = (int*)malloc((size_t)acc.num_parts * K * sizeof(int));
+  }
+
+  // --- Medição de Tempo do Algoritmo Principal ---
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);  // Inicia o cronômetro
+
+  // Laço principal do K-Means (A única parte que será medida)
+  run_kmeans(dataset.coords, &labels, centroids, M, K, D, I, &acc, policy != EMPTY_KEEP ? &empty : NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);  // Para o cronômetro
+
+  // Calcula o tempo decorrido em segundos
+  double time_taken = (end.tv_sec - start.tv_sec) + 1e-9 * (end.tv_nsec - start.tv_nsec);
+
+  // --- Apresentação dos Resultados ---
+  print_time_and_checksum(centroids, K, D, time_taken);
+  fprintf(stderr, "Threads OpenMP: %d\n", acc.num_parts);
+  if (policy != EMPTY_KEEP) {
+    fprintf(stderr, "Clusters vazios que receberam um ponto (--empty=%s): %lld\n",
+            policy == EMPTY_FARTHEST ? "farthest" : "split", empty.relocated);
+  }
+
+  // --- Limpeza ---
+  free_dataset(&dataset);
+  acc_set_free(&acc);
+  free(empty.far_dist);
+  free(empty.far_point);
+  free(centroids);
+  free(labels.data);
+
+  return EXIT_SUCCESS;
+}
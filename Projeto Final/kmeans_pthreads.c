@@ -0,0 +1,456 @@
+#define _GNU_SOURCE  // Necessário para CLOCK_MONOTONIC, MAP_POPULATE e pthread_setaffinity_np
+#include <limits.h>  // Para LLONG_MAX e INT_MAX
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>  // Header correto para clock_gettime e struct timespec
+#include <unistd.h>
+
+#include "kmeans_dataset.h"  // Leitura dos datasets (texto ou binário .kmb)
+#include "kmeans_init.h"     // Inicialização kmeans++ / kmeans||
+#include "kmeans_labels.h"   // Coordenadas planas + rótulos compactos por ponto
+#include "kmeans_reduce.h"   // Acumuladores por thread e redução determinística
+
+// Tamanho da linha de cache: cada área privada começa em uma linha própria
+#define CACHE_LINE 64
+
+// Voltas de espera ativa na barreira antes de dormir no futex
+#define BARRIER_SPINS 4000
+
+// --- Funções Utilitárias ---
+
+/**
+ * @brief Calcula a distância Euclidiana ao quadrado entre dois pontos com coordenadas inteiras.
+ * Usa 'long long' para evitar overflow no cálculo da distância e da diferença.
+ * @return A distância Euclidiana ao quadrado como um long long.
+ */
+long long euclidean_dist_sq(const int* p1, const int* p2, int D) {
+  long long dist = 0;
+  for (int i = 0; i < D; i++) {
+    long long diff = (long long)p1[i] - p2[i];
+    dist += diff * diff;
+  }
+  return dist;
+}
+
+// --- Barreira com Inversão de Sentido ---
+
+/*
+ * A última thread a chegar restaura o contador e inverte 'sense'; as demais
+ * esperam 'sense' assumir o valor que cada uma guardou localmente. A espera
+ * começa ativa (as fases são curtas e equilibradas) e, se demorar, a thread
+ * dorme no futex de 'sense', de modo que threads a mais que núcleos não
+ * disputam a CPU. 'waiters' evita a chamada de sistema de despertar quando
+ * ninguém dormiu.
+ */
+
+typedef struct {
+  _Alignas(CACHE_LINE) atomic_int count;
+  _Alignas(CACHE_LINE) atomic_int sense;
+  atomic_int waiters;
+  int num_threads;
+} SenseBarrier;
+
+void barrier_init(SenseBarrier* b, int num_threads) {
+  atomic_init(&b->count, num_threads);
+  atomic_init(&b->sense, 0);
+  atomic_init(&b->waiters, 0);
+  b->num_threads = num_threads;
+}
+
+/**
+ * @brief Espera todas as threads; 'local_sense' é o sentido privado da thread.
+ */
+void barrier_wait(SenseBarrier* b, int* local_sense) {
+  int sense = !*local_sense;
+  *local_sense = sense;
+
+  if (atomic_fetch_sub(&b->count, 1) == 1) {
+    atomic_store(&b->count, b->num_threads);
+    atomic_store(&b->sense, sense);
+    if (atomic_load(&b->waiters) > 0) {
+      syscall(SYS_futex, &b->sense, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+    return;
+  }
+
+  for (int spin = 0; spin < BARRIER_SPINS; spin++) {
+    if (atomic_load_explicit(&b->sense, memory_order_acquire) == sense) return;
+    __builtin_ia32_pause();
+  }
+  atomic_fetch_add(&b->waiters, 1);
+  while (atomic_load(&b->sense) != sense) {
+    // Só dorme se 'sense' ainda tem o valor antigo; senão retorna na hora
+    syscall(SYS_futex, &b->sense, FUTEX_WAIT_PRIVATE, !sense, NULL, NULL, 0);
+  }
+  atomic_fetch_sub(&b->waiters, 1);
+}
+
+// --- Pool de Threads ---
+
+/*
+ * O pool é criado uma única vez, fora da medição de tempo; a thread principal
+ * participa como trabalhadora 0. Cada iteração tem duas fases separadas por
+ * barreiras:
+ *  1. cada thread atribui sua faixa fixa de pontos e já os soma na sua área
+ *     de um AccumulatorSet (kmeans_reduce.h, alinhada à linha de cache);
+ *  2. cada thread combina as áreas de todas as threads (em ordem fixa) para a
+ *     sua faixa de clusters e calcula esses centroides, então a combinação
+ *     também é paralela e não há escrita compartilhada.
+ * As somas são inteiras, então o resultado é idêntico ao sequencial.
+ *
+ * Antes da largada, o pool também executa a atualização das distâncias de
+ * kmeans++/kmeans|| (init_executor de kmeans_init.h): a thread principal
+ * publica o laço e cada trabalhadora processa a sua faixa entre duas barreiras.
+ */
+
+typedef struct KMeansPool KMeansPool;
+
+typedef struct {
+  KMeansPool* pool;
+  int id;
+  int cpu;            // Núcleo em que a thread é fixada (-1 = sem fixação)
+  int sense;          // Sentido privado na barreira
+  int point_begin, point_end;
+  int cluster_begin, cluster_end;
+} Worker;
+
+struct KMeansPool {
+  const int* coords;  // M * D coordenadas dos pontos
+  Labels labels;      // Cluster de cada ponto (M); cada thread escreve só a sua faixa
+  int* centroids;     // K * D coordenadas dos centroides
+  int M, K, D, I;
+  int num_threads;
+  Worker* workers;
+  pthread_t* handles;
+  AccumulatorSet accum;  // Uma área por thread
+  long long* merged;     // Totais; cada thread escreve só a sua faixa de clusters
+  SenseBarrier barrier;
+  // Laço da inicialização publicado pela thread principal (NULL = largada)
+  InitRangeBody init_body;
+  void* init_arg;
+  int init_count;
+};
+
+/**
+ * @brief Fixa a thread atual no núcleo 'cpu'.
+ */
+void pin_current_thread(int cpu) {
+  if (cpu < 0) return;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    fprintf(stderr, "Aviso: Não foi possível fixar a thread no núcleo %d.\n", cpu);
+  }
+}
+
+/**
+ * @brief Fase 1: atribuição da faixa de pontos da thread + somas privadas.
+ */
+void assign_and_accumulate(KMeansPool* pool, Worker* w) {
+  int K = pool->K, D = pool->D;
+  long long* mine = acc_part(&pool->accum, w->id);
+  acc_part_clear(&pool->accum, w->id);
+
+  for (int i = w->point_begin; i < w->point_end; i++) {
+    const int* point = &pool->coords[(size_t)i * D];
+    long long min_dist = LLONG_MAX;
+    int best_cluster = -1;
+
+    for (int j = 0; j < K; j++) {
+      long long dist = euclidean_dist_sq(point, &pool->centroids[j * D], D);
+      if (dist < min_dist) {
+        min_dist = dist;
+        best_cluster = j;
+      }
+    }
+    label_set(&pool->labels, i, best_cluster);
+    acc_add_point(mine, point, best_cluster, K, D);
+  }
+}
+
+/**
+ * @brief Fase 2: combina as somas de todas as threads para a faixa de clusters
+ * da thread e recalcula esses centroides (divisão inteira). Clusters vazios
+ * mantêm o centroide anterior.
+ */
+void merge_cluster_range(KMeansPool* pool, Worker* w) {
+  acc_merge_clusters(&pool->accum, pool->K, pool->D, w->cluster_begin, w->cluster_end, pool->merged);
+  acc_centroids_range(pool->merged, pool->centroids, pool->K, pool->D, w->cluster_begin, w->cluster_end);
+}
+
+/**
+ * @brief Executa a faixa da thread no laço da inicialização publicado.
+ */
+void run_init_slice(KMeansPool* pool, Worker* w) {
+  int begin = (int)((long long)pool->init_count * w->id / pool->num_threads);
+  int end = (int)((long long)pool->init_count * (w->id + 1) / pool->num_threads);
+  pool->init_body(pool->init_arg, begin, end);
+}
+
+/**
+ * @brief Executor da inicialização (InitExecutor.run): chamado só pela thread
+ * principal, antes da largada.
+ */
+void pool_parallel_for(void* ctx, int count, InitRangeBody body, void* arg) {
+  KMeansPool* pool = (KMeansPool*)ctx;
+  Worker* w = &pool->workers[0];
+  pool->init_body = body;
+  pool->init_arg = arg;
+  pool->init_count = count;
+  barrier_wait(&pool->barrier, &w->sense);  // Publica o laço
+  run_init_slice(pool, w);
+  barrier_wait(&pool->barrier, &w->sense);  // Todas as faixas prontas
+}
+
+/**
+ * @brief As I iterações de uma trabalhadora, depois da largada.
+ */
+void run_iterations(Worker* w) {
+  KMeansPool* pool = w->pool;
+  for (int iter = 0; iter < pool->I; iter++) {
+    assign_and_accumulate(pool, w);
+    barrier_wait(&pool->barrier, &w->sense);
+    merge_cluster_range(pool, w);
+    barrier_wait(&pool->barrier, &w->sense);
+  }
+}
+
+/**
+ * @brief Thread principal (trabalhadora 0): dá a largada e executa as I iterações.
+ */
+void run_main_worker(KMeansPool* pool) {
+  pool->init_body = NULL;
+  barrier_wait(&pool->barrier, &pool->workers[0].sense);  // Largada (cronômetro já iniciado)
+  run_iterations(&pool->workers[0]);
+}
+
+/**
+ * @brief Trabalhadoras 1..num_threads-1: atendem os laços da inicialização
+ * até a largada e então executam as I iterações.
+ */
+void* worker_thread(void* arg) {
+  Worker* w = (Worker*)arg;
+  KMeansPool* pool = w->pool;
+  pin_current_thread(w->cpu);
+  for (;;) {
+    barrier_wait(&pool->barrier, &w->sense);
+    if (pool->init_body == NULL) break;  // Largada
+    run_init_slice(pool, w);
+    barrier_wait(&pool->barrier, &w->sense);
+  }
+  run_iterations(w);
+  return NULL;
+}
+
+/**
+ * @brief Divide pontos e clusters em faixas contíguas, aloca os acumuladores e
+ * cria as threads 1..num_threads-1 (que ficam na barreira, à espera dos laços
+ * da inicialização ou da largada).
+ */
+void pool_create(KMeansPool* pool, const int* coords, Labels labels, int* centroids, int M, int K, int D, int I,
+                 int num_threads) {
+  pool->coords = coords;
+  pool->labels = labels;
+  pool->centroids = centroids;
+  pool->M = M;
+  pool->K = K;
+  pool->D = D;
+  pool->I = I;
+  pool->num_threads = num_threads;
+  pool->workers = (Worker*)malloc(num_threads * sizeof(Worker));
+  pool->handles = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+  barrier_init(&pool->barrier, num_threads);
+  pool->init_body = NULL;
+
+  acc_set_alloc(&pool->accum, num_threads, K, D);
+  pool->merged = (long long*)malloc(acc_len(K, D) * sizeof(long long));
+  if (pool->workers == NULL || pool->handles == NULL || pool->merged == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar o pool de threads.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // Núcleos permitidos ao processo, usados em rodízio para fixar as threads
+  cpu_set_t allowed;
+  int cpus[CPU_SETSIZE], num_cpus = 0;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+      if (CPU_ISSET(c, &allowed)) cpus[num_cpus++] = c;
+    }
+  }
+
+  for (int t = 0; t < num_threads; t++) {
+    Worker* w = &pool->workers[t];
+    w->pool = pool;
+    w->id = t;
+    w->sense = 0;
+    w->cpu = num_cpus > 0 ? cpus[t % num_cpus] : -1;
+    w->point_begin = (int)((long long)M * t / num_threads);
+    w->point_end = (int)((long long)M * (t + 1) / num_threads);
+    w->cluster_begin = (int)((long long)K * t / num_threads);
+    w->cluster_end = (int)((long long)K * (t + 1) / num_threads);
+  }
+
+  pin_current_thread(pool->workers[0].cpu);
+  for (int t = 1; t < num_threads; t++) {
+    if (pthread_create(&pool->handles[t], NULL, worker_thread, &pool->workers[t]) != 0) {
+      fprintf(stderr, "Erro: Não foi possível criar a thread %d.\n", t);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/**
+ * @brief Espera as threads terminarem e libera o pool.
+ */
+void pool_destroy(KMeansPool* pool) {
+  for (int t = 1; t < pool->num_threads; t++) {
+    pthread_join(pool->handles[t], NULL);
+  }
+  acc_set_free(&pool->accum);
+  free(pool->merged);
+  free(pool->workers);
+  free(pool->handles);
+}
+
+// --- Funções Principais do K-Means ---
+
+/**
+ * @brief Inicializa os centroides escolhendo K pontos aleatórios do dataset
+ * (mesmo sorteio da versão sequencial).
+ */
+void initialize_centroids(const int* coords, int* centroids, int M, int K, int D) {
+  srand(42);  // Semente fixa para reprodutibilidade
+
+  int* indices = (int*)malloc(M * sizeof(int));
+  for (int i = 0; i < M; i++) {
+    indices[i] = i;
+  }
+
+  for (int i = 0; i < M; i++) {
+    int j = rand() % M;
+    int temp = indices[i];
+    indices[i] = indices[j];
+    indices[j] = temp;
+  }
+
+  for (int i = 0; i < K; i++) {
+    memcpy(&centroids[i * D], &coords[(size_t)indices[i] * D], D * sizeof(int));
+  }
+
+  free(indices);
+}
+
+/**
+ * @brief Calcula e imprime o tempo de execução e o checksum final.
+ * A saída é formatada para ser facilmente lida por scripts:
+ * Linha 1: Tempo de execução em segundos (double)
+ * Linha 2: Checksum final (long long)
+ */
+void print_time_and_checksum(const int* centroids, int K, int D, double exec_time) {
+  long long checksum = 0;
+  for (int i = 0; i < K; i++) {
+    for (int j = 0; j < D; j++) {
+      checksum += centroids[i * D + j];
+    }
+  }
+  // Saída formatada para o avaliador
+  printf("%lf\n", exec_time);
+  printf("%lld\n", checksum);
+}
+
+/**
+ * @brief Lê os argumentos opcionais: o número de threads e --init=<estratégia>.
+ * @return 1 em caso de sucesso, 0 se algum for inválido.
+ */
+int parse_options(int argc, char* argv[], int first, int* num_threads, InitStrategy* init) {
+  int threads_given = 0;
+  *num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  *init = INIT_RANDOM;
+  for (int i = first; i < argc; i++) {
+    if (strncmp(argv[i], "--init=", 7) == 0) {
+      if (!init_parse(argv[i] + 7, init)) return 0;
+    } else if (!threads_given) {
+      *num_threads = atoi(argv[i]);
+      threads_given = 1;
+    } else {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// --- Função Principal ---
+
+int main(int argc, char* argv[]) {
+  // Validação e leitura dos argumentos de linha de comando
+  int T;  // Número de threads
+  InitStrategy init;
+  if (argc < 6 || !parse_options(argc, argv, 6, &T, &init)) {
+    fprintf(stderr,
+            "Uso: %s <arquivo_dados> <M_pontos> <D_dimensoes> <K_clusters> <I_iteracoes> [threads] "
+            "[--init=random|kmeans++|kmeans||]\n",
+            argv[0]);
+    fprintf(stderr, "Sem [threads], usa um thread por núcleo disponível.\n");
+    return EXIT_FAILURE;
+  }
+
+  const char* filename = argv[1];  // Nome do arquivo de dados
+  const int M = atoi(argv[2]);     // Número de pontos
+  const int D = atoi(argv[3]);     // Número de dimensões
+  const int K = atoi(argv[4]);     // Número de clusters
+  const int I = atoi(argv[5]);     // Número de iterações
+
+  if (M <= 0 || D <= 0 || K <= 0 || I <= 0 || K > M || T <= 0) {
+    fprintf(stderr, "Erro nos parâmetros. Verifique se M,D,K,I,threads > 0 e K <= M.\n");
+    return EXIT_FAILURE;
+  }
+
+  // --- Alocação de Memória ---
+  Dataset dataset = {0};
+  int* centroids = (int*)malloc((size_t)K * D * sizeof(int));
+  Labels labels = labels_wrap(malloc(labels_size(M, K)), K);
+  KMeansPool pool;
+  // ... (verificação de alocação) ...
+
+  // --- Preparação (Fora da medição de tempo) ---
+  load_dataset(filename, M, D, &dataset);
+  pool_create(&pool, dataset.coords, labels, centroids, M, K, D, I, T);
+  if (init == INIT_RANDOM) {
+    initialize_centroids(dataset.coords, centroids, M, K, D);
+  } else {
+    // As distâncias de kmeans++/kmeans|| são atualizadas pelas threads do pool
+    init_executor = (InitExecutor){pool_parallel_for, &pool};
+    init_centers(init, dataset.coords, M, D, K, centroids);
+  }
+
+  // --- Medição de Tempo do Algoritmo Principal ---
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);  // Inicia o cronômetro
+
+  // Laço principal do K-Means (A única parte que será medida)
+  run_main_worker(&pool);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);  // Para o cronômetro
+
+  // Calcula o tempo decorrido em segundos
+  double time_taken = (end.tv_sec - start.tv_sec) + 1e-9 * (end.tv_nsec - start.tv_nsec);
+
+  // --- Apresentação dos Resultados ---
+  print_time_and_checksum(centroids, K, D, time_taken);
+  fprintf(stderr, "Threads: %d\n", T);
+
+  // --- Limpeza ---
+  pool_destroy(&pool);
+  free_dataset(&dataset);
+  free(centroids);
+  free(labels.data);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+// kmeans_reduce.h
+//
+// Camada de redução compartilhada pelas versões paralelas do K-Means (OpenMP,
+// Pthreads, MPI e híbrida). Como kmeans_dataset.h, tudo é 'static inline' para
+// que cada programa continue sendo compilado a partir de um único arquivo .c.
+//
+// Garantia: o resultado de uma redução não depende do número de threads ou
+// processos nem da ordem em que as parcelas ficam prontas.
+//  - Somas de coordenadas e contagens são inteiras (int64). A soma inteira é
+//    associativa e comutativa, então qualquer árvore, divisão em blocos ou
+//    ordem de chegada dá exatamente o mesmo total: os centroides e o checksum
+//    são idênticos aos da versão sequencial. Os merges abaixo ainda seguem uma
+//    topologia fixa (ordem crescente de área / árvore por passos de 2^n) para
+//    que o padrão de acesso também seja reprodutível.
+//  - Nenhuma redução aqui usa ponto flutuante: uma soma de doubles depende da
+//    ordem das parcelas e quebraria essa garantia.
+#ifndef KMEANS_REDUCE_H
+#define KMEANS_REDUCE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tamanho da linha de cache: cada área privada começa em uma linha própria
+#define ACC_CACHE_LINE 64
+
+// --- Acumuladores de Cluster ---
+
+/*
+ * Layout de um acumulador: K * D somas de coordenadas seguidas de K contagens,
+ * todas long long, de modo que um acumulador inteiro segue em uma única
+ * mensagem (ex.: um MPI_Allreduce de MPI_LONG_LONG).
+ */
+
+static inline size_t acc_len(int K, int D) { return (size_t)K * D + K; }
+
+static inline long long* acc_counts(long long* acc, int K, int D) { return acc + (size_t)K * D; }
+
+/**
+ * @brief Soma o ponto 'coords' no cluster 'cluster_id' do acumulador.
+ */
+static inline void acc_add_point(long long* acc, const int* coords, int cluster_id, int K, int D) {
+  acc[(size_t)K * D + cluster_id]++;
+  for (int d = 0; d < D; d++) {
+    acc[(size_t)cluster_id * D + d] += coords[d];
+  }
+}
+
+/**
+ * @brief dst[i] += src[i] para i em [begin, end).
+ */
+static inline void acc_add(long long* dst, const long long* src, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    dst[i] += src[i];
+  }
+}
+
+/**
+ * @brief Recalcula os centroides [k_begin, k_end) como a média (divisão
+ * inteira) das somas do acumulador. Clusters vazios mantêm o centroide
+ * anterior. 'centroid_coords' tem K * D coordenadas, ponto a ponto.
+ */
+static inline void acc_centroids_range(const long long* acc, int* centroid_coords, int K, int D, int k_begin,
+                                       int k_end) {
+  const long long* counts = acc + (size_t)K * D;
+  for (int k = k_begin; k < k_end; k++) {
+    if (counts[k] > 0) {
+      for (int d = 0; d < D; d++) {
+        // Divisão inteira para manter os centroides em coordenadas discretas
+        centroid_coords[k * D + d] = acc[(size_t)k * D + d] / counts[k];
+      }
+    }
+  }
+}
+
+static inline void acc_centroids(const long long* acc, int* centroid_coords, int K, int D) {
+  acc_centroids_range(acc, centroid_coords, K, D, 0, K);
+}
+
+// --- Áreas Privadas por Thread ---
+
+/*
+ * Um acumulador por thread (ou por parte), cada um começando em uma linha de
+ * cache própria para evitar falso compartilhamento. As áreas não são tocadas
+ * na alocação: cada thread deve zerar a sua, o que também posiciona as páginas
+ * no nó NUMA dela (primeiro toque).
+ */
+typedef struct {
+  char* base;     // Bloco único com todas as áreas
+  size_t stride;  // Bytes por área (múltiplo de ACC_CACHE_LINE)
+  size_t len;     // Elementos por área: acc_len(K, D)
+  int num_parts;
+} AccumulatorSet;
+
+static inline void acc_set_alloc(AccumulatorSet* set, int num_parts, int K, int D) {
+  set->len = acc_len(K, D);
+  set->stride = (set->len * sizeof(long long) + ACC_CACHE_LINE - 1) / ACC_CACHE_LINE * ACC_CACHE_LINE;
+  set->num_parts = num_parts;
+  set->base = (char*)aligned_alloc(ACC_CACHE_LINE, set->stride * num_parts);
+  if (set->base == NULL) {
+    fprintf(stderr, "Erro: Falha ao alocar os acumuladores das threads.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static inline void acc_set_free(AccumulatorSet* set) {
+  free(set->base);
+  set->base = NULL;
+}
+
+static inline long long* acc_part(const AccumulatorSet* set, int p) {
+  return (long long*)(set->base + set->stride * p);
+}
+
+static inline void acc_part_clear(const AccumulatorSet* set, int p) {
+  memset(acc_part(set, p), 0, set->len * sizeof(long long));
+}
+
+/**
+ * @brief Um nível da redução em árvore: com passo 'step' (1, 2, 4, ...), a
+ * parte 'p' múltipla de 2*step recebe a parte p + step. Depois de todos os
+ * níveis (separados por barreiras, inclusive antes do primeiro), a parte 0
+ * tem o total. A forma da árvore só depende de num_parts.
+ */
+static inline void acc_tree_step(const AccumulatorSet* set, int p, int step) {
+  if (p % (2 * step) == 0 && p + step < set->num_parts) {
+    acc_add(acc_part(set, p), acc_part(set, p + step), 0, set->len);
+  }
+}
+
+/**
+ * @brief dst[i] = soma das partes 0..num_parts-1 (nessa ordem) para i em
+ * [begin, end). Permite dividir o merge entre threads por faixa de elementos.
+ */
+static inline void acc_merge_range(const AccumulatorSet* set, size_t begin, size_t end, long long* dst) {
+  memcpy(&dst[begin], &acc_part(set, 0)[begin], (end - begin) * sizeof(long long));
+  for (int p = 1; p < set->num_parts; p++) {
+    acc_add(dst, acc_part(set, p), begin, end);
+  }
+}
+
+/**
+ * @brief Merge da faixa de clusters [k_begin, k_end): as somas e as contagens
+ * desses clusters ficam em 'dst'.
+ */
+static inline void acc_merge_clusters(const AccumulatorSet* set, int K, int D, int k_begin, int k_end,
+                                      long long* dst) {
+  acc_merge_range(set, (size_t)k_begin * D, (size_t)k_end * D, dst);
+  acc_merge_range(set, (size_t)K * D + k_begin, (size_t)K * D + k_end, dst);
+}
+
+#endif  // KMEANS_REDUCE_H
@@ -1,142 +1,2262 @@
-#define _POSIX_C_SOURCE 199309L  // Necessário para CLOCK_MONOTONIC
+#define _GNU_SOURCE  // Necessário para CLOCK_MONOTONIC e MAP_POPULATE
+#include <immintrin.h>           // Intrínsecos AVX2/AVX-512 do motor vetorizado
+#include <float.h>               // Para FLT_EPSILON
 #include <limits.h>              // Para LLONG_MAX
+#include <stdint.h>              // Para int16_t/int8_t do layout estreito
+#include <math.h>                // Para sqrt (limites do motor com poda); compilar com -lm
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>  // Header correto para clock_gettime e struct timespec
+#include <time.h>    // Header correto para clock_gettime e struct timespec
+#include <unistd.h>  // Para sysconf (tamanhos de cache)
+
+#include "kmeans_arena.h"    // Arena com páginas enormes para todos os buffers
+#include "kmeans_dataset.h"  // Leitura dos datasets (texto ou binário .kmb)
+#include "kmeans_init.h"     // Inicialização kmeans++ / kmeans||
+#include "kmeans_labels.h"   // Coordenadas planas + rótulos compactos por ponto
+
+// Motores disponíveis para a fase de atribuição
+typedef enum {
+  ASSIGN_BASELINE,  // Laço original ponto a ponto (referência)
+  ASSIGN_SIMD,      // Layout em blocos + kernel vetorizado escolhido em tempo de execução
+  ASSIGN_TILED,     // Blocos de pontos x blocos de centroides dimensionados para L1/L2
+  ASSIGN_HAMERLY,   // Poda por desigualdade triangular com 1 limite inferior por ponto
+  ASSIGN_ELKAN,     // Poda por desigualdade triangular com K limites inferiores por ponto
+  ASSIGN_NARROW,    // Coordenadas em int16/int8 + kernel madd (sempre em passada fundida)
+  ASSIGN_GEMM       // ||x||² - 2x·c + ||c||² com o produto X * C^T em blocos (inteiro, exato)
+} AssignEngine;
+
+// O que fazer com um cluster que ficou sem pontos na atribuição
+typedef enum {
+  EMPTY_KEEP,      // Mantém o centroide anterior (padrão, comportamento original)
+  EMPTY_FARTHEST,  // Recebe o ponto mais distante do seu centroide
+  EMPTY_SPLIT      // Recebe o ponto mais distante do maior cluster, dividindo-o
+} EmptyPolicy;
+
+// Formato das métricas de qualidade impressas após as duas linhas do avaliador
+typedef enum {
+  METRICS_NONE,  // Só tempo e checksum (padrão)
+  METRICS_JSON,  // Um objeto JSON em uma linha
+  METRICS_CSV    // Tabela por iteração + tabela de tamanhos dos clusters
+} MetricsFormat;
+
+// Dimensões de um tile da fase de atribuição (0 = ajuste automático)
+typedef struct {
+  int points;     // Pontos por tile (reaproveitados em L2)
+  int centroids;  // Centroides por tile (mantidos em L1)
+} TileShape;
+
+// Opções extras aceitas após os 5 argumentos obrigatórios
+typedef struct {
+  AssignEngine assign;  // Motor da fase de atribuição
+  const char* isa;      // Kernel dos motores SIMD, narrow e GEMM: auto, avx512, avx2 ou scalar
+  TileShape tile;       // Tile do motor --assign=tiled
+  int fused;            // Atribuição e acumulação das somas em uma única passada
+  int delta_update;     // Atualiza somas só com os pontos que mudaram de cluster
+  int converge;         // Encerra antes de I iterações quando as atribuições estabilizam
+  double converge_tol;  // Fração de M abaixo da qual a rotatividade encerra (0 = modo exato)
+  int stream_chunk;     // Pontos por trecho no modo em fluxo (0 = dataset inteiro em memória)
+  InitStrategy init;    // Escolha dos centroides iniciais
+  int batch_size;       // Pontos sorteados por iteração no modo mini-batch (0 = todos os M pontos)
+  int final_pass;       // Mini-batch: atribui todos os pontos ao final
+  uint64_t seed;        // Semente do sorteio dos mini-batches
+  int report_cost;      // Relata a soma das distâncias ao quadrado ao final
+  MetricsFormat metrics;  // Métricas de qualidade e convergência por iteração
+  EmptyPolicy empty;    // Tratamento de clusters vazios
+  int specialize;       // Kernels com D fixo em tempo de compilação (D = 2, 3, 10, 16, 32)
+  int huge_pages;       // Arena em páginas enormes (1, padrão) ou normais (0, para comparação)
+} KMeansOptions;
+
+// --- Funções Utilitárias ---
+
+/**
+ * @brief Calcula a distância Euclidiana ao quadrado entre dois pontos com coordenadas inteiras.
+ * Usa 'long long' para evitar overflow no cálculo da distância e da diferença.
+ * @return A distância Euclidiana ao quadrado como um long long.
+ */
+long long euclidean_dist_sq(const int* p1, const int* p2, int D) {
+  long long dist = 0;
+  for (int i = 0; i < D; i++) {
+    long long diff = (long long)p1[i] - p2[i];
+    dist += diff * diff;
+  }
+  return dist;
+}
+
+// --- Motor de Atribuição Vetorizado (SIMD) ---
+
+// Pontos por bloco no layout vetorizado (16 inteiros de 32 bits = 1 registrador AVX-512)
+#define SIMD_BLOCK 16
+
+/**
+ * Pontos reorganizados em blocos de SIMD_BLOCK pontos. Dentro de cada bloco as
+ * coordenadas ficam agrupadas por dimensão (layout "AoSoA"):
+ *   data[(b * D + d) * SIMD_BLOCK + l] = coordenada d do ponto (b * SIMD_BLOCK + l)
+ * Uma única carga alinhada traz a mesma dimensão de 16 pontos consecutivos.
+ */
+typedef struct {
+  int* data;
+  int num_blocks;
+} PointBlocks;
+
+// Assinatura comum dos kernels de atribuição sobre o layout em blocos
+// (processa os blocos [b_begin, b_end), grava o rótulo dos pontos correspondentes
+// e devolve a soma das suas distâncias mínimas, sem as posições de preenchimento)
+typedef long long (*BlockAssignKernel)(const PointBlocks* blocks, const int* centroids, Labels* labels, int M, int K, int D,
+                                  int b_begin, int b_end);
+
+/**
+ * @brief Copia os pontos para o layout em blocos (na arena). O último bloco é
+ * completado com zeros; os resultados dessas posições extras são descartados
+ * pelos kernels.
+ */
+PointBlocks build_point_blocks(const int* coords, int M, int D, Arena* arena) {
+  PointBlocks pb;
+  pb.num_blocks = (M + SIMD_BLOCK - 1) / SIMD_BLOCK;
+  pb.data = (int*)arena_alloc(arena, (size_t)pb.num_blocks * D * SIMD_BLOCK * sizeof(int));  // zerado
+
+  for (int i = 0; i < M; i++) {
+    int* block = &pb.data[(size_t)(i / SIMD_BLOCK) * D * SIMD_BLOCK];
+    for (int d = 0; d < D; d++) {
+      block[d * SIMD_BLOCK + i % SIMD_BLOCK] = coords[(size_t)i * D + d];
+    }
+  }
+  return pb;
+}
+
+/**
+ * @brief Kernel escalar sobre o layout em blocos. Segue a mesma ordem de
+ * comparação do laço original (centroides em ordem crescente, 'dist < min_dist'),
+ * então empates continuam resolvidos para o menor índice de cluster.
+ */
+long long assign_blocks_scalar(const PointBlocks* pb, const int* centroids, Labels* labels, int M, int K, int D,
+                               int b_begin, int b_end) {
+  long long inertia = 0;
+  for (int b = b_begin; b < b_end; b++) {
+    const int* block = &pb->data[(size_t)b * D * SIMD_BLOCK];
+    long long min_dist[SIMD_BLOCK];
+    int best_cluster[SIMD_BLOCK];
+    for (int l = 0; l < SIMD_BLOCK; l++) {
+      min_dist[l] = LLONG_MAX;
+      best_cluster[l] = -1;
+    }
+
+    for (int j = 0; j < K; j++) {
+      long long dist[SIMD_BLOCK] = {0};
+      for (int d = 0; d < D; d++) {
+        long long c = centroids[j * D + d];
+        for (int l = 0; l < SIMD_BLOCK; l++) {
+          long long diff = block[d * SIMD_BLOCK + l] - c;
+          dist[l] += diff * diff;
+        }
+      }
+      for (int l = 0; l < SIMD_BLOCK; l++) {
+        if (dist[l] < min_dist[l]) {
+          min_dist[l] = dist[l];
+          best_cluster[l] = j;
+        }
+      }
+    }
+
+    int base = b * SIMD_BLOCK;
+    for (int l = 0; l < SIMD_BLOCK && base + l < M; l++) {
+      label_set(labels, base + l, best_cluster[l]);
+      inertia += min_dist[l];
+    }
+  }
+  return inertia;
+}
+
+/**
+ * @brief Kernel AVX2: 8 pontos por instrução. A diferença é feita em 32 bits
+ * (seguro porque a amplitude dos dados cabe em um int, ver select_simd_kernel) e
+ * o quadrado é acumulado em 64 bits com _mm256_mul_epi32, separado em pistas
+ * pares e ímpares. O resultado é idêntico ao cálculo em 'long long'.
+ */
+__attribute__((target("avx2"))) long long assign_blocks_avx2(const PointBlocks* pb, const int* centroids,
+                                                              Labels* labels, int M, int K, int D, int b_begin,
+                                                              int b_end) {
+  long long inertia = 0;
+  for (int b = b_begin; b < b_end; b++) {
+    const int* block = &pb->data[(size_t)b * D * SIMD_BLOCK];
+    // [0] = pontos 0..7 do bloco, [1] = pontos 8..15; "even"/"odd" = pistas pares/ímpares
+    __m256i min_even[2], min_odd[2], best_even[2], best_odd[2];
+    for (int h = 0; h < 2; h++) {
+      min_even[h] = min_odd[h] = _mm256_set1_epi64x(LLONG_MAX);
+      best_even[h] = best_odd[h] = _mm256_set1_epi64x(-1);
+    }
+
+    for (int j = 0; j < K; j++) {
+      __m256i acc_even[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+      __m256i acc_odd[2] = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+      for (int d = 0; d < D; d++) {
+        __m256i c = _mm256_set1_epi32(centroids[j * D + d]);
+        for (int h = 0; h < 2; h++) {
+          __m256i p = _mm256_load_si256((const __m256i*)&block[d * SIMD_BLOCK + 8 * h]);
+          __m256i diff = _mm256_sub_epi32(p, c);
+          __m256i diff_odd = _mm256_srli_epi64(diff, 32);
+          acc_even[h] = _mm256_add_epi64(acc_even[h], _mm256_mul_epi32(diff, diff));
+          acc_odd[h] = _mm256_add_epi64(acc_odd[h], _mm256_mul_epi32(diff_odd, diff_odd));
+        }
+      }
+      __m256i cluster = _mm256_set1_epi64x(j);
+      for (int h = 0; h < 2; h++) {
+        __m256i lt_even = _mm256_cmpgt_epi64(min_even[h], acc_even[h]);  // dist < min_dist
+        __m256i lt_odd = _mm256_cmpgt_epi64(min_odd[h], acc_odd[h]);
+        min_even[h] = _mm256_blendv_epi8(min_even[h], acc_even[h], lt_even);
+        min_odd[h] = _mm256_blendv_epi8(min_odd[h], acc_odd[h], lt_odd);
+        best_even[h] = _mm256_blendv_epi8(best_even[h], cluster, lt_even);
+        best_odd[h] = _mm256_blendv_epi8(best_odd[h], cluster, lt_odd);
+      }
+    }
+
+    long long even[4], odd[4], dist_even[4], dist_odd[4];
+    for (int h = 0; h < 2; h++) {
+      _mm256_storeu_si256((__m256i*)even, best_even[h]);
+      _mm256_storeu_si256((__m256i*)odd, best_odd[h]);
+      _mm256_storeu_si256((__m256i*)dist_even, min_even[h]);
+      _mm256_storeu_si256((__m256i*)dist_odd, min_odd[h]);
+      int base = b * SIMD_BLOCK + 8 * h;
+      for (int l = 0; l < 4; l++) {
+        if (base + 2 * l < M) {
+          label_set(labels, base + 2 * l, (int)even[l]);
+          inertia += dist_even[l];
+        }
+        if (base + 2 * l + 1 < M) {
+          label_set(labels, base + 2 * l + 1, (int)odd[l]);
+          inertia += dist_odd[l];
+        }
+      }
+    }
+  }
+  return inertia;
+}
+
+/**
+ * @brief Kernel AVX-512: mesma estratégia do AVX2, com 16 pontos (um bloco
+ * inteiro) por instrução e comparações via máscaras.
+ */
+__attribute__((target("avx512f"))) long long assign_blocks_avx512(const PointBlocks* pb, const int* centroids,
+                                                                   Labels* labels, int M, int K, int D, int b_begin,
+                                                                   int b_end) {
+  long long inertia = 0;
+  for (int b = b_begin; b < b_end; b++) {
+    const int* block = &pb->data[(size_t)b * D * SIMD_BLOCK];
+    __m512i min_even = _mm512_set1_epi64(LLONG_MAX), min_odd = min_even;
+    __m512i best_even = _mm512_set1_epi64(-1), best_odd = best_even;
+
+    for (int j = 0; j < K; j++) {
+      __m512i acc_even = _mm512_setzero_si512(), acc_odd = _mm512_setzero_si512();
+      for (int d = 0; d < D; d++) {
+        __m512i p = _mm512_load_si512((const void*)&block[d * SIMD_BLOCK]);
+        __m512i diff = _mm512_sub_epi32(p, _mm512_set1_epi32(centroids[j * D + d]));
+        __m512i diff_odd = _mm512_srli_epi64(diff, 32);
+        acc_even = _mm512_add_epi64(acc_even, _mm512_mul_epi32(diff, diff));
+        acc_odd = _mm512_add_epi64(acc_odd, _mm512_mul_epi32(diff_odd, diff_odd));
+      }
+      __m512i cluster = _mm512_set1_epi64(j);
+      __mmask8 lt_even = _mm512_cmplt_epi64_mask(acc_even, min_even);
+      __mmask8 lt_odd = _mm512_cmplt_epi64_mask(acc_odd, min_odd);
+      min_even = _mm512_mask_mov_epi64(min_even, lt_even, acc_even);
+      min_odd = _mm512_mask_mov_epi64(min_odd, lt_odd, acc_odd);
+      best_even = _mm512_mask_mov_epi64(best_even, lt_even, cluster);
+      best_odd = _mm512_mask_mov_epi64(best_odd, lt_odd, cluster);
+    }
+
+    int base = b * SIMD_BLOCK;
+    if (base + SIMD_BLOCK <= M) {
+      inertia += _mm512_reduce_add_epi64(_mm512_add_epi64(min_even, min_odd));
+    } else {
+      long long dist_even[8], dist_odd[8];
+      _mm512_storeu_si512((void*)dist_even, min_even);
+      _mm512_storeu_si512((void*)dist_odd, min_odd);
+      for (int l = 0; l < 8; l++) {
+        if (base + 2 * l < M) inertia += dist_even[l];
+        if (base + 2 * l + 1 < M) inertia += dist_odd[l];
+      }
+    }
+    long long even[8], odd[8];
+    _mm512_storeu_si512((void*)even, best_even);
+    _mm512_storeu_si512((void*)odd, best_odd);
+    for (int l = 0; l < 8; l++) {
+      if (base + 2 * l < M) label_set(labels, base + 2 * l, (int)even[l]);
+      if (base + 2 * l + 1 < M) label_set(labels, base + 2 * l + 1, (int)odd[l]);
+    }
+  }
+  return inertia;
+}
+
+/**
+ * @brief Escolhe o kernel vetorizado de acordo com a CPU e com a opção --isa.
+ * Os kernels AVX fazem a subtração em 32 bits, o que só é exato quando a
+ * amplitude (max - min) das coordenadas cabe em um int (os centroides são
+ * médias dos pontos, então ficam dentro do mesmo intervalo); caso contrário, ou se a
+ * CPU não suportar o conjunto pedido, usa o kernel escalar.
+ * @return O kernel escolhido; seu nome é devolvido em 'name'.
+ */
+BlockAssignKernel select_simd_kernel(const char* isa, long long coord_range, const char** name) {
+  int exact_32bit = coord_range <= INT_MAX;
+  int want_avx512 = strcmp(isa, "auto") == 0 || strcmp(isa, "avx512") == 0;
+  int want_avx2 = want_avx512 || strcmp(isa, "avx2") == 0;
+
+  __builtin_cpu_init();
+  if (exact_32bit && want_avx512 && __builtin_cpu_supports("avx512f")) {
+    *name = "simd-avx512";
+    return assign_blocks_avx512;
+  }
+  if (exact_32bit && want_avx2 && __builtin_cpu_supports("avx2")) {
+    *name = "simd-avx2";
+    return assign_blocks_avx2;
+  }
+  *name = "simd-scalar";
+  return assign_blocks_scalar;
+}
+
+// --- Motor de Atribuição com Coordenadas Estreitas (int16 / int8) ---
+
+/*
+ * As coordenadas do gerador ficam em [0, max_val] (ex.: 10000), então não
+ * precisam de 32 bits. Quando a amplitude dos dados permite, os pontos são
+ * guardados deslocados pelo menor valor ('base') em int16 (amplitude <= 32767)
+ * ou int8 (amplitude <= 127), o que corta o tamanho do vetor de pontos e a
+ * banda da varredura pela metade ou por 4. Como a distância não muda com a
+ * translação, os centroides são deslocados pela mesma base.
+ *
+ * Layout: blocos de SIMD_BLOCK pontos; para cada par de dimensões (2q, 2q+1)
+ * os 16 pontos ficam intercalados [p0d2q p0d2q+1 p1d2q p1d2q+1 ...], de modo que
+ * _mm*_madd_epi16 sobre as diferenças devolve diff[2q]^2 + diff[2q+1]^2 de cada
+ * ponto em uma pista de 32 bits. Com amplitude <= 32767 essa soma cabe em um int
+ * sem sinal de overflow. As pistas são acumuladas em 32 bits se D * amplitude^2
+ * cabe em um int, e em 64 bits caso contrário. D ímpar é completado com 0.
+ */
+
+typedef struct {
+  void* data;      // int16_t ou int8_t, num_blocks * pairs * 2 * SIMD_BLOCK elementos
+  int num_blocks;
+  int pairs;       // Pares de dimensões: (D + 1) / 2
+  int elem_bytes;  // 2 (int16) ou 1 (int8)
+  int wide_acc;    // 1 se a distância precisa de acumulador de 64 bits
+  int base;        // Valor subtraído de todas as coordenadas
+} NarrowBlocks;
+
+// Kernel de atribuição sobre o layout estreito; 'centroid_pairs' tem K * pairs
+// valores de 32 bits, cada um com as duas coordenadas (já deslocadas) do par.
+// Devolve a soma das distâncias mínimas, como BlockAssignKernel.
+typedef long long (*NarrowAssignKernel)(const NarrowBlocks* nb, const int* centroid_pairs, Labels* labels, int M,
+                                        int K, int b_begin, int b_end);
+
+/**
+ * @brief Escolhe o tipo de armazenamento e o acumulador a partir do intervalo de
+ * valores do dataset.
+ * @return 1 se cabe em int16/int8, 0 se for preciso manter int32.
+ */
+int choose_narrow_format(int min_val, int max_val, int D, NarrowBlocks* nb) {
+  long long range = (long long)max_val - min_val;
+  if (range > 32767) return 0;
+  nb->elem_bytes = range <= 127 ? 1 : 2;
+  nb->wide_acc = (long long)(D + 1) * range * range > INT_MAX;
+  nb->base = min_val;
+  return 1;
+}
+
+/**
+ * @brief Constrói o layout estreito (na arena) a partir dos pontos.
+ */
+void build_narrow_blocks(const int* coords, int M, int D, NarrowBlocks* nb, Arena* arena) {
+  nb->num_blocks = (M + SIMD_BLOCK - 1) / SIMD_BLOCK;
+  nb->pairs = (D + 1) / 2;
+  size_t elems = (size_t)nb->num_blocks * nb->pairs * 2 * SIMD_BLOCK;
+  nb->data = arena_alloc(arena, elems * nb->elem_bytes);  // zerado
+
+  for (int i = 0; i < M; i++) {
+    size_t block = (size_t)(i / SIMD_BLOCK) * nb->pairs * 2 * SIMD_BLOCK;
+    for (int d = 0; d < D; d++) {
+      size_t at = block + (size_t)(d / 2) * 2 * SIMD_BLOCK + (i % SIMD_BLOCK) * 2 + d % 2;
+      int value = coords[(size_t)i * D + d] - nb->base;
+      if (nb->elem_bytes == 2) {
+        ((int16_t*)nb->data)[at] = (int16_t)value;
+      } else {
+        ((int8_t*)nb->data)[at] = (int8_t)value;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Converte os centroides para pares de 16 bits deslocados pela base.
+ */
+void pack_centroid_pairs(const NarrowBlocks* nb, const int* centroids, int K, int D, int* centroid_pairs) {
+  for (int j = 0; j < K; j++) {
+    for (int q = 0; q < nb->pairs; q++) {
+      int lo = centroids[j * D + 2 * q] - nb->base;
+      int hi = 2 * q + 1 < D ? centroids[j * D + 2 * q + 1] - nb->base : 0;
+      centroid_pairs[j * nb->pairs + q] = (int)((uint32_t)(uint16_t)lo | ((uint32_t)(uint16_t)hi << 16));
+    }
+  }
+}
+
+/**
+ * @brief Lê a coordenada (deslocada) d do ponto l do bloco b.
+ */
+int narrow_coord(const NarrowBlocks* nb, int b, int l, int d) {
+  size_t at = ((size_t)b * nb->pairs + d / 2) * 2 * SIMD_BLOCK + l * 2 + d % 2;
+  return nb->elem_bytes == 2 ? ((const int16_t*)nb->data)[at] : ((const int8_t*)nb->data)[at];
+}
+
+/**
+ * @brief Kernel escalar sobre o layout estreito (fallback sem AVX2).
+ */
+long long assign_narrow_scalar(const NarrowBlocks* nb, const int* centroid_pairs, Labels* labels, int M, int K,
+                               int b_begin, int b_end) {
+  long long inertia = 0;
+  for (int b = b_begin; b < b_end; b++) {
+    for (int l = 0; l < SIMD_BLOCK && b * SIMD_BLOCK + l < M; l++) {
+      long long min_dist = LLONG_MAX;
+      int best_cluster = -1;
+      for (int j = 0; j < K; j++) {
+        long long dist = 0;
+        for (int q = 0; q < nb->pairs; q++) {
+          int pair = centroid_pairs[j * nb->pairs + q];
+          long long d0 = narrow_coord(nb, b, l, 2 * q) - (int16_t)(pair & 0xFFFF);
+          long long d1 = narrow_coord(nb, b, l, 2 * q + 1) - (int16_t)((uint32_t)pair >> 16);
+          dist += d0 * d0 + d1 * d1;
+        }
+        if (dist < min_dist) {
+          min_dist = dist;
+          best_cluster = j;
+        }
+      }
+      label_set(labels, b * SIMD_BLOCK + l, best_cluster);
+      inertia += min_dist;
+    }
+  }
+  return inertia;
+}
+
+/**
+ * @brief Corpo do kernel AVX-512BW: 16 pontos (um bloco) por instrução. Com
+ * 'elem_bytes' e 'wide_acc' constantes em cada chamador, o compilador gera uma
+ * versão especializada para cada combinação.
+ */
+__attribute__((target("avx512f,avx512bw"), always_inline)) static inline long long assign_narrow_avx512_body(
+    const NarrowBlocks* nb, const int* centroid_pairs, Labels* labels, int M, int K, int b_begin, int b_end,
+    const int elem_bytes, const int wide_acc) {
+  const int pairs = nb->pairs;
+  long long inertia = 0;
+  for (int b = b_begin; b < b_end; b++) {
+    const char* block = (const char*)nb->data + (size_t)b * pairs * 2 * SIMD_BLOCK * elem_bytes;
+    __m512i min32 = _mm512_set1_epi32(INT_MAX);
+    __m512i min_lo = _mm512_set1_epi64(LLONG_MAX), min_hi = min_lo;
+    __m512i best = _mm512_set1_epi32(-1);
+
+    for (int j = 0; j < K; j++) {
+      __m512i acc = _mm512_setzero_si512(), acc_lo = acc, acc_hi = acc;
+      for (int q = 0; q < pairs; q++) {
+        __m512i p = elem_bytes == 2
+                        ? _mm512_load_si512((const void*)(block + (size_t)q * 64))
+                        : _mm512_cvtepi8_epi16(_mm256_load_si256((const __m256i*)(block + (size_t)q * 32)));
+        __m512i diff = _mm512_sub_epi16(p, _mm512_set1_epi32(centroid_pairs[j * pairs + q]));
+        __m512i sq = _mm512_madd_epi16(diff, diff);
+        if (wide_acc) {
+          acc_lo = _mm512_add_epi64(acc_lo, _mm512_cvtepu32_epi64(_mm512_castsi512_si256(sq)));
+          acc_hi = _mm512_add_epi64(acc_hi, _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(sq, 1)));
+        } else {
+          acc = _mm512_add_epi32(acc, sq);
+        }
+      }
+      __m512i cluster = _mm512_set1_epi32(j);
+      if (wide_acc) {
+        __mmask8 lt_lo = _mm512_cmplt_epi64_mask(acc_lo, min_lo);
+        __mmask8 lt_hi = _mm512_cmplt_epi64_mask(acc_hi, min_hi);
+        min_lo = _mm512_mask_mov_epi64(min_lo, lt_lo, acc_lo);
+        min_hi = _mm512_mask_mov_epi64(min_hi, lt_hi, acc_hi);
+        best = _mm512_mask_mov_epi32(best, (__mmask16)(lt_lo | (lt_hi << 8)), cluster);
+      } else {
+        __mmask16 lt = _mm512_cmplt_epi32_mask(acc, min32);
+        min32 = _mm512_mask_mov_epi32(min32, lt, acc);
+        best = _mm512_mask_mov_epi32(best, lt, cluster);
+      }
+    }
+
+    int best_cluster[SIMD_BLOCK];
+    long long min_dist[SIMD_BLOCK];
+    _mm512_storeu_si512((void*)best_cluster, best);
+    if (wide_acc) {
+      _mm512_storeu_si512((void*)min_dist, min_lo);
+      _mm512_storeu_si512((void*)&min_dist[8], min_hi);
+    } else {
+      _mm512_storeu_si512((void*)min_dist, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(min32)));
+      _mm512_storeu_si512((void*)&min_dist[8], _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(min32, 1)));
+    }
+    for (int l = 0; l < SIMD_BLOCK && b * SIMD_BLOCK + l < M; l++) {
+      label_set(labels, b * SIMD_BLOCK + l, best_cluster[l]);
+      inertia += min_dist[l];
+    }
+  }
+  return inertia;
+}
+
+/**
+ * @brief Corpo do kernel AVX2: 8 pontos por instrução, duas metades por bloco.
+ */
+__attribute__((target("avx2"), always_inline)) static inline long long assign_narrow_avx2_body(
+    const NarrowBlocks* nb, const int* centroid_pairs, Labels* labels, int M, int K, int b_begin, int b_end,
+    const int elem_bytes, const int wide_acc) {
+  const int pairs = nb->pairs;
+  long long inertia = 0;
+  for (int b = b_begin; b < b_end; b++) {
+    const char* block = (const char*)nb->data + (size_t)b * pairs * 2 * SIMD_BLOCK * elem_bytes;
+    int best_cluster[SIMD_BLOCK];
+    long long min_dist[SIMD_BLOCK];
+    for (int h = 0; h < 2; h++) {
+      __m256i min32 = _mm256_set1_epi32(INT_MAX);
+      __m256i min_lo = _mm256_set1_epi64x(LLONG_MAX), min_hi = min_lo;
+      __m256i best = _mm256_set1_epi32(-1);
+
+      for (int j = 0; j < K; j++) {
+        __m256i acc = _mm256_setzero_si256(), acc_lo = acc, acc_hi = acc;
+        for (int q = 0; q < pairs; q++) {
+          const char* at = block + ((size_t)q * 2 * SIMD_BLOCK + h * SIMD_BLOCK) * elem_bytes;
+          __m256i p = elem_bytes == 2 ? _mm256_load_si256((const __m256i*)at)
+                                      : _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i*)at));
+          __m256i diff = _mm256_sub_epi16(p, _mm256_set1_epi32(centroid_pairs[j * pairs + q]));
+          __m256i sq = _mm256_madd_epi16(diff, diff);
+          if (wide_acc) {
+            acc_lo = _mm256_add_epi64(acc_lo, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(sq)));
+            acc_hi = _mm256_add_epi64(acc_hi, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sq, 1)));
+          } else {
+            acc = _mm256_add_epi32(acc, sq);
+          }
+        }
+        __m256i cluster = _mm256_set1_epi32(j);
+        if (wide_acc) {
+          __m256i lt_lo = _mm256_cmpgt_epi64(min_lo, acc_lo);
+          __m256i lt_hi = _mm256_cmpgt_epi64(min_hi, acc_hi);
+          min_lo = _mm256_blendv_epi8(min_lo, acc_lo, lt_lo);
+          min_hi = _mm256_blendv_epi8(min_hi, acc_hi, lt_hi);
+          // Compacta as máscaras de 64 bits (4 + 4 pistas) em uma máscara de 8 pistas de 32 bits
+          __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+          __m256i lt = _mm256_inserti128_si256(_mm256_permutevar8x32_epi32(lt_lo, even),
+                                               _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(lt_hi, even)), 1);
+          best = _mm256_blendv_epi8(best, cluster, lt);
+        } else {
+          __m256i lt = _mm256_cmpgt_epi32(min32, acc);
+          min32 = _mm256_blendv_epi8(min32, acc, lt);
+          best = _mm256_blendv_epi8(best, cluster, lt);
+        }
+      }
+      _mm256_storeu_si256((__m256i*)&best_cluster[8 * h], best);
+      if (wide_acc) {
+        _mm256_storeu_si256((__m256i*)&min_dist[8 * h], min_lo);
+        _mm256_storeu_si256((__m256i*)&min_dist[8 * h + 4], min_hi);
+      } else {
+        _mm256_storeu_si256((__m256i*)&min_dist[8 * h], _mm256_cvtepi32_epi64(_mm256_castsi256_si128(min32)));
+        _mm256_storeu_si256((__m256i*)&min_dist[8 * h + 4],
+                            _mm256_cvtepi32_epi64(_mm256_extracti128_si256(min32, 1)));
+      }
+    }
+    for (int l = 0; l < SIMD_BLOCK && b * SIMD_BLOCK + l < M; l++) {
+      label_set(labels, b * SIMD_BLOCK + l, best_cluster[l]);
+      inertia += min_dist[l];
+    }
+  }
+  return inertia;
+}
+
+// Versões especializadas: armazenamento (i16/i8) x acumulador (32/64 bits)
+#define DEFINE_NARROW_KERNEL(isa, target_isa, suffix, elem_bytes, wide_acc)                                        \
+  __attribute__((target(target_isa))) long long assign_narrow_##isa##_##suffix(                                     \
+      const NarrowBlocks* nb, const int* centroid_pairs, Labels* labels, int M, int K, int b_begin, int b_end) {    \
+    return assign_narrow_##isa##_body(nb, centroid_pairs, labels, M, K, b_begin, b_end, elem_bytes, wide_acc);             \
+  }
+
+DEFINE_NARROW_KERNEL(avx512, "avx512f,avx512bw", i16_acc32, 2, 0)
+DEFINE_NARROW_KERNEL(avx512, "avx512f,avx512bw", i16_acc64, 2, 1)
+DEFINE_NARROW_KERNEL(avx512, "avx512f,avx512bw", i8_acc32, 1, 0)
+DEFINE_NARROW_KERNEL(avx512, "avx512f,avx512bw", i8_acc64, 1, 1)
+DEFINE_NARROW_KERNEL(avx2, "avx2", i16_acc32, 2, 0)
+DEFINE_NARROW_KERNEL(avx2, "avx2", i16_acc64, 2, 1)
+DEFINE_NARROW_KERNEL(avx2, "avx2", i8_acc32, 1, 0)
+DEFINE_NARROW_KERNEL(avx2, "avx2", i8_acc64, 1, 1)
+
+/**
+ * @brief Escolhe o kernel estreito de acordo com a CPU, a opção --isa e o
+ * formato escolhido por choose_narrow_format.
+ */
+NarrowAssignKernel select_narrow_kernel(const char* isa, const NarrowBlocks* nb, const char** name) {
+  static const NarrowAssignKernel avx512[2][2] = {{assign_narrow_avx512_i8_acc32, assign_narrow_avx512_i8_acc64},
+                                                  {assign_narrow_avx512_i16_acc32, assign_narrow_avx512_i16_acc64}};
+  static const NarrowAssignKernel avx2[2][2] = {{assign_narrow_avx2_i8_acc32, assign_narrow_avx2_i8_acc64},
+                                                {assign_narrow_avx2_i16_acc32, assign_narrow_avx2_i16_acc64}};
+  static const char* names512[2][2] = {{"narrow-avx512-i8-acc32", "narrow-avx512-i8-acc64"},
+                                       {"narrow-avx512-i16-acc32", "narrow-avx512-i16-acc64"}};
+  static const char* names2[2][2] = {{"narrow-avx2-i8-acc32", "narrow-avx2-i8-acc64"},
+                                     {"narrow-avx2-i16-acc32", "narrow-avx2-i16-acc64"}};
+  int want_avx512 = strcmp(isa, "auto") == 0 || strcmp(isa, "avx512") == 0;
+  int want_avx2 = want_avx512 || strcmp(isa, "avx2") == 0;
+  int s = nb->elem_bytes == 2, a = nb->wide_acc;
+
+  __builtin_cpu_init();
+  if (want_avx512 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+    *name = names512[s][a];
+    return avx512[s][a];
+  }
+  if (want_avx2 && __builtin_cpu_supports("avx2")) {
+    *name = names2[s][a];
+    return avx2[s][a];
+  }
+  *name = "narrow-scalar";
+  return assign_narrow_scalar;
+}
+
+/**
+ * @brief Soma as coordenadas dos pontos dos blocos [b_begin, b_end) lidas do
+ * layout estreito (desfazendo o deslocamento) nos acumuladores do seu cluster.
+ */
+void accumulate_narrow_blocks(const NarrowBlocks* nb, const Labels* labels, int M, int D, int b_begin, int b_end,
+                              long long* cluster_sums, int* cluster_counts) {
+  for (int b = b_begin; b < b_end; b++) {
+    for (int l = 0; l < SIMD_BLOCK && b * SIMD_BLOCK + l < M; l++) {
+      int cluster_id = label_get(labels, b * SIMD_BLOCK + l);
+      cluster_counts[cluster_id]++;
+      for (int d = 0; d < D; d++) {
+        cluster_sums[cluster_id * D + d] += narrow_coord(nb, b, l, d) + nb->base;
+      }
+    }
+  }
+}
+
+// --- Motor de Atribuição em Tiles (Cache Blocking) ---
+
+/**
+ * @brief Fase de Atribuição em tiles: cada tile de pontos é comparado com um
+ * tile de centroides por vez, de modo que os centroides do tile permaneçam em L1
+ * enquanto todos os pontos do tile passam por eles. O par (min_dist, best_cluster)
+ * de cada ponto é mantido entre os tiles de centroides. Como os tiles de
+ * centroides são percorridos em ordem crescente e a comparação continua sendo
+ * 'dist < min_dist', empates vão para o menor índice, como no laço original.
+ * 'min_dist' e 'best_cluster' são áreas de trabalho com tile.points posições.
+ * Atribui os pontos [begin, end).
+ * @return A soma das distâncias mínimas (inércia dos pontos atribuídos).
+ */
+long long assign_points_tiled(const int* coords, const int* centroids, Labels* labels, int begin, int end, int K,
+                              int D, TileShape tile, long long* min_dist, int* best_cluster) {
+  long long inertia = 0;
+  for (int p0 = begin; p0 < end; p0 += tile.points) {
+    int p1 = p0 + tile.points < end ? p0 + tile.points : end;
+    for (int i = p0; i < p1; i++) {
+      min_dist[i - p0] = LLONG_MAX;
+      best_cluster[i - p0] = -1;
+    }
+
+    for (int c0 = 0; c0 < K; c0 += tile.centroids) {
+      int c1 = c0 + tile.centroids < K ? c0 + tile.centroids : K;
+      for (int i = p0; i < p1; i++) {
+        long long best = min_dist[i - p0];
+        int best_j = best_cluster[i - p0];
+        for (int j = c0; j < c1; j++) {
+          long long dist = euclidean_dist_sq(&coords[(size_t)i * D], &centroids[j * D], D);
+          if (dist < best) {
+            best = dist;
+            best_j = j;
+          }
+        }
+        min_dist[i - p0] = best;
+        best_cluster[i - p0] = best_j;
+      }
+    }
+
+    for (int i = p0; i < p1; i++) {
+      label_set(labels, i, best_cluster[i - p0]);
+      inertia += min_dist[i - p0];
+    }
+  }
+  return inertia;
+}
+
+/**
+ * @brief Lê o tamanho de um nível de cache (sysconf), com um valor padrão para
+ * sistemas que não o informam.
+ */
+long cache_size_or(int name, long fallback) {
+  long size = sysconf(name);
+  return size > 0 ? size : fallback;
+}
+
+/**
+ * @brief Ajuste automático do tile, feito uma vez antes da medição de tempo.
+ * Os candidatos partem do tile que ocupa metade da L1 (centroides) e metade da
+ * L2 (pontos); cada um é cronometrado em uma amostra dos pontos e o mais rápido
+ * é escolhido. Só afeta o desempenho: qualquer tile produz o mesmo resultado.
+ */
+TileShape autotune_tiles(const int* coords, const int* centroids, Labels* labels, int M, int K, int D,
+                         Arena* arena) {
+  long row_bytes = (long)D * sizeof(int);
+  long l1 = cache_size_or(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+  long l2 = cache_size_or(_SC_LEVEL2_CACHE_SIZE, 1024 * 1024);
+  int base_c = (int)(l1 / 2 / row_bytes);
+  int base_p = (int)(l2 / 2 / row_bytes);
+  int sample = M < 8192 ? M : 8192;
+
+  long long* min_dist = (long long*)arena_alloc(arena, 2 * (size_t)base_p * sizeof(long long));
+  int* best_cluster = (int*)arena_alloc(arena, 2 * (size_t)base_p * sizeof(int));
+
+  TileShape best = {0, 0};
+  double best_time = 0.0;
+  for (int sp = -2; sp <= 1; sp++) {
+    for (int sc = -2; sc <= 1; sc++) {
+      TileShape cand;
+      cand.points = sp < 0 ? base_p >> -sp : base_p << sp;
+      cand.centroids = sc < 0 ? base_c >> -sc : base_c << sc;
+      if (cand.points < 1) cand.points = 1;
+      if (cand.centroids < 1) cand.centroids = 1;
+      if (cand.points > sample) cand.points = sample;
+      if (cand.centroids > K) cand.centroids = K;
+
+      struct timespec t0, t1;
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      assign_points_tiled(coords, centroids, labels, 0, sample, K, D, cand, min_dist, best_cluster);
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      double elapsed = (t1.tv_sec - t0.tv_sec) + 1e-9 * (t1.tv_nsec - t0.tv_nsec);
+      if (best.points == 0 || elapsed < best_time) {
+        best = cand;
+        best_time = elapsed;
+      }
+    }
+  }
+
+  return best;
+}
+
+// --- Motor de Atribuição como Produto de Matrizes (GEMM Inteiro) ---
+
+/*
+ * --assign=gemm usa a expansão ||x - c||² = ||x||² - 2 x·c + ||c||². As normas
+ * dos pontos são calculadas uma vez (os pontos não mudam) e as dos centroides
+ * uma vez por iteração; o que sobra é o produto X * C^T, feito em blocos:
+ * pontos em microtiles de GEMM_MR linhas e centroides empacotados em painéis
+ * de 'panel' colunas intercaladas por dimensão,
+ *   packed[(p * D + d) * panel + l] = coordenada d do centroide (p * panel + l),
+ * de modo que o microkernel carrega uma linha de painel com uma instrução e a
+ * multiplica pela coordenada de cada um dos GEMM_MR pontos, mantendo os
+ * GEMM_MR x panel produtos parciais em registradores durante todo o laço de D.
+ *
+ * Tudo é inteiro de 64 bits: cada produto int32 x int32 é exato em 64 bits e
+ * as somas são feitas módulo 2^64 (sem sinal nos laços escalares). Como a
+ * identidade acima vale nos inteiros módulo 2^64, o resultado é exatamente a
+ * distância do laço original sempre que ela cabe em um long long (a mesma
+ * condição de euclidean_dist_sq), mesmo que ||x||² ou x·c estourem sozinhos.
+ * O último painel é completado com cópias do último centroide: elas empatam
+ * com ele e perdem o desempate, que continua indo para o menor índice.
+ */
+
+// Pontos por microtile (linhas do microkernel)
+#define GEMM_MR 4
+
+// Assinatura dos microkernels: compara GEMM_MR pontos com os painéis [p_begin, p_end)
+// e atualiza min_dist/best_cluster de cada ponto (empate fica com o menor índice)
+typedef void (*GemmMicroKernel)(const int* const rows[GEMM_MR], const long long* row_norms, const long long* packed,
+                                const long long* centroid_norms, int p_begin, int p_end, int D, long long* min_dist,
+                                int* best_cluster);
+
+typedef struct {
+  GemmMicroKernel kernel;
+  int panel;                  // Centroides por painel (largura do kernel escolhido)
+  int num_panels;             // ceil(K / panel)
+  int block_panels;           // Painéis por bloco de centroides (mantido em L1)
+  int block_points;           // Pontos por tile (mantido em L2; múltiplo de GEMM_MR)
+  long long* point_norms;     // ||x||² de cada ponto (M)
+  long long* centroid_norms;  // ||c||² de cada coluna empacotada (num_panels * panel)
+  long long* packed;          // Centroides empacotados (num_panels * D * panel)
+  long long* min_dist;        // Área de trabalho: menor distância de cada ponto do tile (block_points)
+  int* best_cluster;          // Área de trabalho: cluster correspondente (block_points)
+} GemmState;
+
+/**
+ * @brief ||v||² de um vetor int32, com a soma feita módulo 2^64 (ver acima).
+ */
+long long gemm_norm(const int* v, int D) {
+  unsigned long long norm = 0;
+  for (int d = 0; d < D; d++) {
+    norm += (unsigned long long)((long long)v[d] * v[d]);
+  }
+  return (long long)norm;
+}
+
+/**
+ * @brief Combina os mínimos por pista de um bloco de painéis com o mínimo já
+ * acumulado do ponto. Dentro do bloco vence a menor distância e, no empate, o
+ * menor índice; blocos anteriores têm índices menores, então só uma distância
+ * estritamente menor os substitui.
+ */
+void gemm_merge_lanes(const long long* lane_dist, const long long* lane_cluster, int lanes, long long* min_dist,
+                      int* best_cluster) {
+  long long best = LLONG_MAX;
+  long long best_j = -1;
+  for (int l = 0; l < lanes; l++) {
+    if (lane_cluster[l] >= 0 && (lane_dist[l] < best || (lane_dist[l] == best && lane_cluster[l] < best_j))) {
+      best = lane_dist[l];
+      best_j = lane_cluster[l];
+    }
+  }
+  if (best_j >= 0 && best < *min_dist) {
+    *min_dist = best;
+    *best_cluster = (int)best_j;
+  }
+}
+
+// Larguras de painel de cada microkernel (pistas de 64 bits: 4 escalares, 2 x ymm, 2 x zmm)
+#define GEMM_PANEL_SCALAR 4
+#define GEMM_PANEL_AVX2 8
+#define GEMM_PANEL_AVX512 16
+
+/**
+ * @brief Microkernel escalar: GEMM_MR x 4 produtos parciais sem sinal.
+ */
+void gemm_kernel_scalar(const int* const rows[GEMM_MR], const long long* row_norms, const long long* packed,
+                        const long long* centroid_norms, int p_begin, int p_end, int D, long long* min_dist,
+                        int* best_cluster) {
+  long long lane_dist[GEMM_MR][GEMM_PANEL_SCALAR], lane_cluster[GEMM_MR][GEMM_PANEL_SCALAR];
+  for (int r = 0; r < GEMM_MR; r++) {
+    for (int l = 0; l < GEMM_PANEL_SCALAR; l++) {
+      lane_dist[r][l] = LLONG_MAX;
+      lane_cluster[r][l] = -1;
+    }
+  }
+
+  for (int p = p_begin; p < p_end; p++) {
+    const long long* panel = &packed[(size_t)p * D * GEMM_PANEL_SCALAR];
+    unsigned long long dot[GEMM_MR][GEMM_PANEL_SCALAR] = {{0}};
+    for (int d = 0; d < D; d++) {
+      for (int r = 0; r < GEMM_MR; r++) {
+        long long x = rows[r][d];
+        for (int l = 0; l < GEMM_PANEL_SCALAR; l++) {
+          dot[r][l] += (unsigned long long)(x * panel[d * GEMM_PANEL_SCALAR + l]);
+        }
+      }
+    }
+    for (int r = 0; r < GEMM_MR; r++) {
+      for (int l = 0; l < GEMM_PANEL_SCALAR; l++) {
+        int j = p * GEMM_PANEL_SCALAR + l;
+        long long dist =
+            (long long)((unsigned long long)row_norms[r] + (unsigned long long)centroid_norms[j] - 2 * dot[r][l]);
+        if (dist < lane_dist[r][l]) {
+          lane_dist[r][l] = dist;
+          lane_cluster[r][l] = j;
+        }
+      }
+    }
+  }
+
+  for (int r = 0; r < GEMM_MR; r++) {
+    gemm_merge_lanes(lane_dist[r], lane_cluster[r], GEMM_PANEL_SCALAR, &min_dist[r], &best_cluster[r]);
+  }
+}
+
+/**
+ * @brief Microkernel AVX2: painéis de 8 centroides (2 registradores de 4
+ * pistas de 64 bits), produto com _mm256_mul_epi32 (int32 x int32 -> int64).
+ * O laço de D usa 8 acumuladores + 2 linhas de painel + 1 difusão.
+ */
+__attribute__((target("avx2"))) void gemm_kernel_avx2(const int* const rows[GEMM_MR], const long long* row_norms,
+                                                       const long long* packed, const long long* centroid_norms,
+                                                       int p_begin, int p_end, int D, long long* min_dist,
+                                                       int* best_cluster) {
+  __m256i lane_dist[GEMM_MR][2], lane_cluster[GEMM_MR][2];
+  for (int r = 0; r < GEMM_MR; r++) {
+    for (int h = 0; h < 2; h++) {
+      lane_dist[r][h] = _mm256_set1_epi64x(LLONG_MAX);
+      lane_cluster[r][h] = _mm256_set1_epi64x(-1);
+    }
+  }
+
+  for (int p = p_begin; p < p_end; p++) {
+    const long long* panel = &packed[(size_t)p * D * GEMM_PANEL_AVX2];
+    __m256i dot[GEMM_MR][2];
+    for (int r = 0; r < GEMM_MR; r++) {
+      dot[r][0] = dot[r][1] = _mm256_setzero_si256();
+    }
+    for (int d = 0; d < D; d++) {
+      __m256i c0 = _mm256_load_si256((const __m256i*)&panel[d * GEMM_PANEL_AVX2]);
+      __m256i c1 = _mm256_load_si256((const __m256i*)&panel[d * GEMM_PANEL_AVX2 + 4]);
+      for (int r = 0; r < GEMM_MR; r++) {
+        __m256i x = _mm256_set1_epi64x(rows[r][d]);
+        dot[r][0] = _mm256_add_epi64(dot[r][0], _mm256_mul_epi32(x, c0));
+        dot[r][1] = _mm256_add_epi64(dot[r][1], _mm256_mul_epi32(x, c1));
+      }
+    }
+
+    const long long* norms = &centroid_norms[p * GEMM_PANEL_AVX2];
+    __m256i cn[2] = {_mm256_loadu_si256((const __m256i*)norms), _mm256_loadu_si256((const __m256i*)&norms[4])};
+    __m256i cluster[2] = {_mm256_setr_epi64x(p * 8, p * 8 + 1, p * 8 + 2, p * 8 + 3),
+                          _mm256_setr_epi64x(p * 8 + 4, p * 8 + 5, p * 8 + 6, p * 8 + 7)};
+    for (int r = 0; r < GEMM_MR; r++) {
+      __m256i xn = _mm256_set1_epi64x(row_norms[r]);
+      for (int h = 0; h < 2; h++) {
+        __m256i dist = _mm256_sub_epi64(_mm256_add_epi64(xn, cn[h]), _mm256_add_epi64(dot[r][h], dot[r][h]));
+        __m256i lt = _mm256_cmpgt_epi64(lane_dist[r][h], dist);  // dist < lane_dist
+        lane_dist[r][h] = _mm256_blendv_epi8(lane_dist[r][h], dist, lt);
+        lane_cluster[r][h] = _mm256_blendv_epi8(lane_cluster[r][h], cluster[h], lt);
+      }
+    }
+  }
+
+  for (int r = 0; r < GEMM_MR; r++) {
+    long long dist[GEMM_PANEL_AVX2], cluster[GEMM_PANEL_AVX2];
+    for (int h = 0; h < 2; h++) {
+      _mm256_storeu_si256((__m256i*)&dist[4 * h], lane_dist[r][h]);
+      _mm256_storeu_si256((__m256i*)&cluster[4 * h], lane_cluster[r][h]);
+    }
+    gemm_merge_lanes(dist, cluster, GEMM_PANEL_AVX2, &min_dist[r], &best_cluster[r]);
+  }
+}
+
+/**
+ * @brief Microkernel AVX-512: painéis de 16 centroides (2 registradores de 8
+ * pistas), com comparações via máscaras.
+ */
+__attribute__((target("avx512f"))) void gemm_kernel_avx512(const int* const rows[GEMM_MR], const long long* row_norms,
+                                                            const long long* packed, const long long* centroid_norms,
+                                                            int p_begin, int p_end, int D, long long* min_dist,
+                                                            int* best_cluster) {
+  __m512i lane_dist[GEMM_MR][2], lane_cluster[GEMM_MR][2];
+  for (int r = 0; r < GEMM_MR; r++) {
+    for (int h = 0; h < 2; h++) {
+      lane_dist[r][h] = _mm512_set1_epi64(LLONG_MAX);
+      lane_cluster[r][h] = _mm512_set1_epi64(-1);
+    }
+  }
+  const __m512i lane = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+
+  for (int p = p_begin; p < p_end; p++) {
+    const long long* panel = &packed[(size_t)p * D * GEMM_PANEL_AVX512];
+    __m512i dot[GEMM_MR][2];
+    for (int r = 0; r < GEMM_MR; r++) {
+      dot[r][0] = dot[r][1] = _mm512_setzero_si512();
+    }
+    for (int d = 0; d < D; d++) {
+      __m512i c0 = _mm512_load_si512((const void*)&panel[d * GEMM_PANEL_AVX512]);
+      __m512i c1 = _mm512_load_si512((const void*)&panel[d * GEMM_PANEL_AVX512 + 8]);
+      for (int r = 0; r < GEMM_MR; r++) {
+        __m512i x = _mm512_set1_epi64(rows[r][d]);
+        dot[r][0] = _mm512_add_epi64(dot[r][0], _mm512_mul_epi32(x, c0));
+        dot[r][1] = _mm512_add_epi64(dot[r][1], _mm512_mul_epi32(x, c1));
+      }
+    }
+
+    const long long* norms = &centroid_norms[p * GEMM_PANEL_AVX512];
+    __m512i cn[2] = {_mm512_loadu_si512((const void*)norms), _mm512_loadu_si512((const void*)&norms[8])};
+    __m512i cluster[2] = {_mm512_add_epi64(lane, _mm512_set1_epi64(p * 16)),
+                          _mm512_add_epi64(lane, _mm512_set1_epi64(p * 16 + 8))};
+    for (int r = 0; r < GEMM_MR; r++) {
+      __m512i xn = _mm512_set1_epi64(row_norms[r]);
+      for (int h = 0; h < 2; h++) {
+        __m512i dist = _mm512_sub_epi64(_mm512_add_epi64(xn, cn[h]), _mm512_add_epi64(dot[r][h], dot[r][h]));
+        __mmask8 lt = _mm512_cmplt_epi64_mask(dist, lane_dist[r][h]);
+        lane_dist[r][h] = _mm512_mask_mov_epi64(lane_dist[r][h], lt, dist);
+        lane_cluster[r][h] = _mm512_mask_mov_epi64(lane_cluster[r][h], lt, cluster[h]);
+      }
+    }
+  }
+
+  for (int r = 0; r < GEMM_MR; r++) {
+    long long dist[GEMM_PANEL_AVX512], cluster[GEMM_PANEL_AVX512];
+    for (int h = 0; h < 2; h++) {
+      _mm512_storeu_si512((void*)&dist[8 * h], lane_dist[r][h]);
+      _mm512_storeu_si512((void*)&cluster[8 * h], lane_cluster[r][h]);
+    }
+    gemm_merge_lanes(dist, cluster, GEMM_PANEL_AVX512, &min_dist[r], &best_cluster[r]);
+  }
+}
+
+/**
+ * @brief Escolhe o microkernel de acordo com a CPU e com --isa. Não há
+ * restrição de amplitude: os produtos são sempre exatos em 64 bits.
+ */
+GemmMicroKernel select_gemm_kernel(const char* isa, int* panel, const char** name) {
+  int want_avx512 = strcmp(isa, "auto") == 0 || strcmp(isa, "avx512") == 0;
+  int want_avx2 = want_avx512 || strcmp(isa, "avx2") == 0;
+
+  __builtin_cpu_init();
+  if (want_avx512 && __builtin_cpu_supports("avx512f")) {
+    *panel = GEMM_PANEL_AVX512;
+    *name = "gemm-avx512";
+    return gemm_kernel_avx512;
+  }
+  if (want_avx2 && __builtin_cpu_supports("avx2")) {
+    *panel = GEMM_PANEL_AVX2;
+    *name = "gemm-avx2";
+    return gemm_kernel_avx2;
+  }
+  *panel = GEMM_PANEL_SCALAR;
+  *name = "gemm-scalar";
+  return gemm_kernel_scalar;
+}
+
+/**
+ * @brief Empacota os centroides em painéis e calcula suas normas, uma vez por
+ * iteração (antes da atribuição). Colunas além de K repetem o último centroide.
+ */
+void gemm_pack_centroids(GemmState* g, const int* centroids, int K, int D) {
+  for (int j = 0; j < g->num_panels * g->panel; j++) {
+    const int* c = &centroids[(j < K ? j : K - 1) * D];
+    long long* column = &g->packed[(size_t)(j / g->panel) * D * g->panel + j % g->panel];
+    for (int d = 0; d < D; d++) {
+      column[d * g->panel] = c[d];
+    }
+    g->centroid_norms[j] = gemm_norm(c, D);
+  }
+}
+
+/**
+ * @brief Atribuição dos pontos [begin, end): tiles de block_points pontos
+ * contra blocos de block_panels painéis, com o mínimo de cada ponto mantido
+ * entre os blocos (como em assign_points_tiled). O último microtile de cada
+ * tile repete o último ponto; essas linhas extras são descartadas.
+ * @return A soma das distâncias mínimas (inércia dos pontos atribuídos).
+ */
+long long assign_points_gemm(GemmState* g, const int* coords, Labels* labels, int D, int begin, int end) {
+  long long inertia = 0;
+  for (int p0 = begin; p0 < end; p0 += g->block_points) {
+    int p1 = p0 + g->block_points < end ? p0 + g->block_points : end;
+    int rows_padded = (p1 - p0 + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    for (int i = 0; i < rows_padded; i++) {
+      g->min_dist[i] = LLONG_MAX;
+      g->best_cluster[i] = -1;
+    }
+
+    for (int c0 = 0; c0 < g->num_panels; c0 += g->block_panels) {
+      int c1 = c0 + g->block_panels < g->num_panels ? c0 + g->block_panels : g->num_panels;
+      for (int i = p0; i < p1; i += GEMM_MR) {
+        const int* rows[GEMM_MR];
+        long long row_norms[GEMM_MR];
+        for (int r = 0; r < GEMM_MR; r++) {
+          int row = i + r < p1 ? i + r : p1 - 1;
+          rows[r] = &coords[(size_t)row * D];
+          row_norms[r] = g->point_norms[row];
+        }
+        g->kernel(rows, row_norms, g->packed, g->centroid_norms, c0, c1, D, &g->min_dist[i - p0],
+                  &g->best_cluster[i - p0]);
+      }
+    }
+
+    for (int i = p0; i < p1; i++) {
+      label_set(labels, i, g->best_cluster[i - p0]);
+      inertia += g->min_dist[i - p0];
+    }
+  }
+  return inertia;
+}
+
+/**
+ * @brief Prepara o motor (fora da medição de tempo): kernel, tamanhos de bloco
+ * a partir das caches, normas dos pontos e áreas de trabalho.
+ */
+void gemm_setup(GemmState* g, const char* isa, const int* coords, int M, int K, int D, Arena* arena,
+                const char** name) {
+  g->kernel = select_gemm_kernel(isa, &g->panel, name);
+  g->num_panels = (K + g->panel - 1) / g->panel;
+
+  long panel_bytes = (long)D * g->panel * sizeof(long long);
+  long l1 = cache_size_or(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+  long l2 = cache_size_or(_SC_LEVEL2_CACHE_SIZE, 1024 * 1024);
+  g->block_panels = (int)(l1 / 2 / panel_bytes);
+  if (g->block_panels < 1) g->block_panels = 1;
+  g->block_points = (int)(l2 / 2 / ((long)D * sizeof(int))) / GEMM_MR * GEMM_MR;
+  if (g->block_points < GEMM_MR) g->block_points = GEMM_MR;
+  if (g->block_points > M) g->block_points = (M + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+
+  g->packed = (long long*)arena_alloc(arena, (size_t)g->num_panels * panel_bytes);
+  g->centroid_norms = (long long*)arena_alloc(arena, (size_t)g->num_panels * g->panel * sizeof(long long));
+  g->point_norms = (long long*)arena_alloc(arena, (size_t)M * sizeof(long long));
+  g->min_dist = (long long*)arena_alloc(arena, (size_t)g->block_points * sizeof(long long));
+  g->best_cluster = (int*)arena_alloc(arena, (size_t)g->block_points * sizeof(int));
+  for (int i = 0; i < M; i++) {
+    g->point_norms[i] = gemm_norm(&coords[(size_t)i * D], D);
+  }
+}
+
+// --- Motor de Atribuição com Poda (Hamerly / Elkan) ---
+
+/*
+ * Os dois motores mantêm, para cada ponto, um limite superior da distância ao
+ * seu centroide e limites inferiores das distâncias aos demais, corrigidos a
+ * cada iteração pelo deslocamento de cada centroide. Um centroide só é
+ * descartado quando o limite prova que ele está ESTRITAMENTE mais longe que o
+ * atual; os que sobram têm a distância inteira calculada e comparada com a regra
+ * do baseline (menor distância, empate para o menor índice). Assim o
+ * rótulo é sempre idêntico ao da força bruta.
+ *
+ * Os limites são distâncias reais (sqrt) em ponto flutuante; para que o
+ * arredondamento nunca torne um teste otimista, todo limite superior é
+ * arredondado para cima e todo limite inferior para baixo (bound_up/bound_down).
+ */
+
+// Margem relativa que cobre com folga o erro de sqrt e das somas em double
+#define BOUND_EPS 1e-12
 
-// Estrutura para representar um ponto no espaço D-dimensional
 typedef struct {
-  int* coords;     // Vetor de coordenadas inteiras
-  int cluster_id;  // ID do cluster ao qual o ponto pertence
-} Point;
+  double* upper;         // Limite superior da distância ao centroide atual (M)
+  double* lower;         // Hamerly: limite inferior da distância ao 2º mais próximo (M)
+  float* lower_elkan;    // Elkan: limite inferior da distância a cada centroide (M * K)
+  double* half_min_cc;   // Metade da distância de cada centroide ao centroide mais próximo (K)
+  double* half_cc;       // Elkan: metade da distância entre cada par de centroides (K * K)
+  double* drift;         // Deslocamento de cada centroide desde a última atribuição (K)
+  int* prev_centroids;   // Centroides usados na última atribuição (K * D)
+  int initialized;       // 0 até a primeira atribuição completa
+  long long computed;    // Distâncias ponto-centroide calculadas
+  long long skipped;     // Distâncias ponto-centroide evitadas pela poda
+} PruneState;
+
+double bound_up(double x) { return x + fabs(x) * BOUND_EPS + BOUND_EPS; }
+
+double bound_down(double x) { return x - fabs(x) * BOUND_EPS - BOUND_EPS; }
+
+/**
+ * @brief Converte um limite inferior para float sem nunca arredondar para cima.
+ */
+float bound_down_float(double x) {
+  float f = (float)x;
+  if (f > x) f -= fabsf(f) * FLT_EPSILON;
+  return f;
+}
+
+/**
+ * @brief Aloca os limites. Elkan usa M * K floats, por isso é indicado para
+ * K grande com memória sobrando; Hamerly usa só 2 doubles por ponto.
+ */
+void prune_alloc(PruneState* ps, AssignEngine engine, int M, int K, int D, Arena* arena) {
+  memset(ps, 0, sizeof(*ps));
+  ps->upper = (double*)arena_alloc(arena, (size_t)M * sizeof(double));
+  ps->half_min_cc = (double*)arena_alloc(arena, (size_t)K * sizeof(double));
+  ps->drift = (double*)arena_alloc(arena, (size_t)K * sizeof(double));
+  ps->prev_centroids = (int*)arena_alloc(arena, (size_t)K * D * sizeof(int));
+  if (engine == ASSIGN_ELKAN) {
+    ps->lower_elkan = (float*)arena_alloc(arena, (size_t)M * K * sizeof(float));
+    ps->half_cc = (double*)arena_alloc(arena, (size_t)K * K * sizeof(double));
+  } else {
+    ps->lower = (double*)arena_alloc(arena, (size_t)M * sizeof(double));
+  }
+}
+
+/**
+ * @brief Preparação de cada iteração: mede o deslocamento dos centroides desde a
+ * última atribuição, afrouxa os limites de acordo e recalcula as distâncias
+ * entre centroides usadas nos testes.
+ */
+void prune_begin_iteration(PruneState* ps, const Labels* labels, const int* centroids, int M, int K, int D) {
+  if (ps->initialized) {
+    double max_drift = 0.0, second_drift = 0.0;
+    int max_j = -1;
+    for (int j = 0; j < K; j++) {
+      ps->drift[j] = bound_up(sqrt((double)euclidean_dist_sq(&ps->prev_centroids[j * D], &centroids[j * D], D)));
+      if (ps->drift[j] > max_drift) {
+        second_drift = max_drift;
+        max_drift = ps->drift[j];
+        max_j = j;
+      } else if (ps->drift[j] > second_drift) {
+        second_drift = ps->drift[j];
+      }
+    }
+
+    for (int i = 0; i < M; i++) {
+      int a = label_get(labels, i);
+      ps->upper[i] = bound_up(ps->upper[i] + ps->drift[a]);
+      if (ps->lower != NULL) {
+        // O 2º mais próximo pode ser qualquer centroide diferente de 'a'
+        ps->lower[i] = bound_down(ps->lower[i] - (a == max_j ? second_drift : max_drift));
+      } else {
+        float* lower = &ps->lower_elkan[(size_t)i * K];
+        for (int j = 0; j < K; j++) {
+          lower[j] = bound_down_float(bound_down(lower[j] - ps->drift[j]));
+        }
+      }
+    }
+  }
+
+  for (int j = 0; j < K; j++) {
+    ps->half_min_cc[j] = INFINITY;
+  }
+  for (int j = 0; j < K; j++) {
+    for (int k = j + 1; k < K; k++) {
+      double half = bound_down(0.5 * sqrt((double)euclidean_dist_sq(&centroids[j * D], &centroids[k * D], D)));
+      if (half < ps->half_min_cc[j]) ps->half_min_cc[j] = half;
+      if (half < ps->half_min_cc[k]) ps->half_min_cc[k] = half;
+      if (ps->half_cc != NULL) {
+        ps->half_cc[j * K + k] = half;
+        ps->half_cc[k * K + j] = half;
+      }
+    }
+  }
+
+  // Centroides usados nesta atribuição, para medir o deslocamento na próxima
+  for (int j = 0; j < K; j++) {
+    memcpy(&ps->prev_centroids[j * D], &centroids[j * D], D * sizeof(int));
+  }
+}
+
+/**
+ * @brief Marca os limites como válidos após a primeira atribuição completa.
+ */
+void prune_end_iteration(PruneState* ps) { ps->initialized = 1; }
+
+/**
+ * @brief Atribuição de Hamerly para os pontos [begin, end).
+ */
+void assign_points_hamerly(PruneState* ps, const int* coords, const int* centroids, Labels* labels, int K, int D,
+                           int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    const int* point = &coords[(size_t)i * D];
+    int a = ps->initialized ? label_get(labels, i) : -1;
+    long long dist_a = -1;
+
+    if (ps->initialized) {
+      double bound = ps->half_min_cc[a] > ps->lower[i] ? ps->half_min_cc[a] : ps->lower[i];
+      if (ps->upper[i] < bound) {
+        ps->skipped += K;
+        continue;
+      }
+      // Aperta o limite superior com a distância exata e testa de novo
+      dist_a = euclidean_dist_sq(point, &centroids[a * D], D);
+      ps->computed++;
+      ps->upper[i] = bound_up(sqrt((double)dist_a));
+      if (ps->upper[i] < bound) {
+        ps->skipped += K - 1;
+        continue;
+      }
+    }
+
+    // Varredura completa, com a mesma regra de desempate do baseline
+    long long min_dist = LLONG_MAX, second_dist = LLONG_MAX;
+    int best_cluster = -1;
+    for (int j = 0; j < K; j++) {
+      long long dist;
+      if (j == a) {
+        dist = dist_a;
+      } else {
+        dist = euclidean_dist_sq(point, &centroids[j * D], D);
+        ps->computed++;
+      }
+      if (dist < min_dist) {
+        second_dist = min_dist;
+        min_dist = dist;
+        best_cluster = j;
+      } else if (dist < second_dist) {
+        second_dist = dist;
+      }
+    }
+    label_set(labels, i, best_cluster);
+    ps->upper[i] = bound_up(sqrt((double)min_dist));
+    ps->lower[i] = second_dist == LLONG_MAX ? INFINITY : bound_down(sqrt((double)second_dist));
+  }
+}
+
+/**
+ * @brief Atribuição de Elkan para os pontos [begin, end).
+ */
+void assign_points_elkan(PruneState* ps, const int* coords, const int* centroids, Labels* labels, int K, int D,
+                         int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    const int* point = &coords[(size_t)i * D];
+    float* lower = &ps->lower_elkan[(size_t)i * K];
+
+    if (!ps->initialized) {
+      long long min_dist = LLONG_MAX;
+      int best_cluster = -1;
+      for (int j = 0; j < K; j++) {
+        long long dist = euclidean_dist_sq(point, &centroids[j * D], D);
+        lower[j] = bound_down_float(bound_down(sqrt((double)dist)));
+        if (dist < min_dist) {
+          min_dist = dist;
+          best_cluster = j;
+        }
+      }
+      ps->computed += K;
+      label_set(labels, i, best_cluster);
+      ps->upper[i] = bound_up(sqrt((double)min_dist));
+      continue;
+    }
+
+    int a = label_get(labels, i);
+    if (ps->upper[i] < ps->half_min_cc[a]) {
+      ps->skipped += K;
+      continue;
+    }
+
+    int first_a = a;
+    long long dist_a = -1;  // distância exata ao centroide atual, quando já calculada
+    for (int j = 0; j < K; j++) {
+      if (j == first_a && first_a != a) continue;  // já calculado e superado por um índice menor
+      if (j == a || ps->upper[i] < lower[j] || ps->upper[i] < ps->half_cc[a * K + j]) {
+        if (j != a) ps->skipped++;
+        continue;
+      }
+      if (dist_a < 0) {
+        dist_a = euclidean_dist_sq(point, &centroids[a * D], D);
+        ps->computed++;
+        ps->upper[i] = bound_up(sqrt((double)dist_a));
+        lower[a] = bound_down_float(bound_down(sqrt((double)dist_a)));
+        if (ps->upper[i] < lower[j] || ps->upper[i] < ps->half_cc[a * K + j]) {
+          ps->skipped++;
+          continue;
+        }
+      }
+      long long dist = euclidean_dist_sq(point, &centroids[j * D], D);
+      ps->computed++;
+      lower[j] = bound_down_float(bound_down(sqrt((double)dist)));
+      if (dist < dist_a || (dist == dist_a && j < a)) {
+        a = j;
+        dist_a = dist;
+        ps->upper[i] = bound_up(sqrt((double)dist));
+      }
+    }
+    if (dist_a < 0) ps->skipped++;  // o próprio centroide atual também não foi recalculado
+    label_set(labels, i, a);
+  }
+}
+
+// --- Funções Principais do K-Means ---
+
+/**
+ * @brief Sorteia os índices dos K pontos usados como centroides iniciais:
+ * embaralha os índices 0..M-1 com semente fixa e fica com os K primeiros.
+ * @return Vetor alocado com K índices.
+ */
+int* choose_initial_indices(int M, int K) {
+  srand(42);  // Semente fixa para reprodutibilidade
+
+  int* indices = (int*)malloc(M * sizeof(int));
+  for (int i = 0; i < M; i++) {
+    indices[i] = i;
+  }
+
+  for (int i = 0; i < M; i++) {
+    int j = rand() % M;
+    int temp = indices[i];
+    indices[i] = indices[j];
+    indices[j] = temp;
+  }
+
+  return (int*)realloc(indices, K * sizeof(int));
+}
+
+/**
+ * @brief Inicializa os centroides escolhendo K pontos aleatórios do dataset.
+ */
+void initialize_centroids(const int* coords, int* centroids, int M, int K, int D) {
+  int* indices = choose_initial_indices(M, K);
+  for (int i = 0; i < K; i++) {
+    memcpy(&centroids[i * D], &coords[(size_t)indices[i] * D], D * sizeof(int));
+  }
+  free(indices);
+}
+
+/**
+ * @brief Versão de initialize_centroids para o modo em fluxo: os mesmos K pontos
+ * são lidos diretamente do arquivo, sem carregar o dataset.
+ */
+void initialize_centroids_streamed(StreamReader* reader, int* centroids, int M, int K, int D) {
+  int* indices = choose_initial_indices(M, K);
+  for (int i = 0; i < K; i++) {
+    read_points_at(reader->fd, reader->data_offset, D, indices[i], 1, &centroids[i * D]);
+  }
+  free(indices);
+}
+
+/**
+ * @brief Fase de Atribuição: Associa cada ponto ao cluster do centroide mais próximo.
+ */
+void assign_points_to_clusters(const int* coords, const int* centroids, Labels* labels, int M, int K, int D) {
+  for (int i = 0; i < M; i++) {
+    long long min_dist = LLONG_MAX;
+    int best_cluster = -1;
+
+    for (int j = 0; j < K; j++) {
+      long long dist = euclidean_dist_sq(&coords[(size_t)i * D], &centroids[j * D], D);
+      if (dist < min_dist) {
+        min_dist = dist;
+        best_cluster = j;
+      }
+    }
+    label_set(labels, i, best_cluster);
+  }
+}
+
+/**
+ * @brief Divide as somas acumuladas de cada cluster pelo seu número de pontos.
+ * Clusters vazios mantêm o centroide anterior.
+ */
+void compute_centroids_from_sums(int* centroids, long long* cluster_sums, int* cluster_counts, int K, int D) {
+  for (int i = 0; i < K; i++) {
+    if (cluster_counts[i] > 0) {
+      for (int j = 0; j < D; j++) {
+        // Divisão inteira para manter os centroides em coordenadas discretas
+        centroids[i * D + j] = cluster_sums[i * D + j] / cluster_counts[i];
+      }
+    }
+  }
+}
+
+/**
+ * @brief Fase de Atualização: Recalcula a posição de cada centroide como a média
+ * (usando divisão inteira) de todos os pontos atribuídos ao seu cluster.
+ * 'cluster_sums' (K * D) e 'cluster_counts' (K) são áreas de trabalho
+ * reservadas na preparação, zeradas aqui a cada chamada.
+ */
+void update_centroids(const int* coords, const Labels* labels, int* centroids, int M, int K, int D,
+                      long long* cluster_sums, int* cluster_counts) {
+  memset(cluster_sums, 0, (size_t)K * D * sizeof(long long));
+  memset(cluster_counts, 0, (size_t)K * sizeof(int));
+
+  for (int i = 0; i < M; i++) {
+    int cluster_id = label_get(labels, i);
+    cluster_counts[cluster_id]++;
+    for (int j = 0; j < D; j++) {
+      cluster_sums[cluster_id * D + j] += coords[(size_t)i * D + j];
+    }
+  }
+
+  compute_centroids_from_sums(centroids, cluster_sums, cluster_counts, K, D);
+}
+
+/**
+ * @brief Índice do centroide mais próximo de 'point' (empate: menor índice);
+ * a distância ao quadrado até ele vai para 'min_dist'.
+ */
+int nearest_centroid(const int* point, const int* centroids, int K, int D, long long* min_dist) {
+  int best_cluster = -1;
+  *min_dist = LLONG_MAX;
+  for (int j = 0; j < K; j++) {
+    long long dist = euclidean_dist_sq(point, &centroids[j * D], D);
+    if (dist < *min_dist) {
+      *min_dist = dist;
+      best_cluster = j;
+    }
+  }
+  return best_cluster;
+}
+
+/**
+ * @brief Fase de Atribuição que também devolve o custo da solução: a soma das
+ * distâncias ao quadrado de cada ponto ao seu centroide.
+ */
+long long assign_points_with_cost(const int* coords, const int* centroids, Labels* labels, int M, int K, int D) {
+  long long cost = 0;
+  for (int i = 0; i < M; i++) {
+    long long min_dist;
+    label_set(labels, i, nearest_centroid(&coords[(size_t)i * D], centroids, K, D, &min_dist));
+    cost += min_dist;
+  }
+  return cost;
+}
 
-// --- Funções Utilitárias ---
+// --- Modo Mini-Batch ---
+
+/*
+ * Cada iteração usa só b pontos sorteados (com reposição) em vez dos M. Os
+ * sorteios são hashes de (semente, iteração, posição no lote), então o lote
+ * não depende de rand() nem da ordem de execução. Os pontos do lote são
+ * atribuídos com os centroides da iteração e então cada centroide c anda em
+ * direção a cada ponto recebido com taxa 1/v_c, em que v_c conta todos os
+ * pontos que c já recebeu (Sculley, 2010). Com essa taxa o centroide é
+ * exatamente a média de todos esses pontos, então basta acumular somas e
+ * contagens inteiras entre as iterações: o passo é exato e a divisão inteira
+ * segue a convenção das outras fases. Centroides que nunca receberam pontos
+ * ficam na posição inicial.
+ */
 
 /**
- * @brief Calcula a distância Euclidiana ao quadrado entre dois pontos com coordenadas inteiras.
- * Usa 'long long' para evitar overflow no cálculo da distância e da diferença.
- * @return A distância Euclidiana ao quadrado como um long long.
+ * @brief Sorteia o lote da iteração 'iter' em 'batch' (b índices de 0 a M-1).
  */
-long long euclidean_dist_sq(Point* p1, Point* p2, int D) {
-  long long dist = 0;
-  for (int i = 0; i < D; i++) {
-    long long diff = (long long)p1->coords[i] - p2->coords[i];
-    dist += diff * diff;
+void sample_batch(int* batch, int b, int M, uint64_t seed, int iter) {
+  for (int s = 0; s < b; s++) {
+    batch[s] = (int)init_uniform(seed, INIT_STREAM_MINIBATCH, iter, s, M);
   }
-  return dist;
 }
 
-// --- Funções Principais do K-Means ---
-
 /**
- * @brief Lê os dados de pontos (inteiros) de um arquivo de texto.
+ * @brief Atribui os pontos do lote e acumula-os nas somas e contagens de todas
+ * as iterações (a atribuição inteira usa os centroides de antes do passo).
  */
-void read_data_from_file(const char* filename, Point* points, int M, int D) {
-  FILE* file = fopen(filename, "r");
-  if (file == NULL) {
-    fprintf(stderr, "Erro: Não foi possível abrir o arquivo '%s'\n", filename);
-    exit(EXIT_FAILURE);
+void minibatch_step(const int* coords, int* centroids, const int* batch, int* batch_cluster, int b, int K, int D,
+                    long long* cluster_sums, int* cluster_counts) {
+  for (int s = 0; s < b; s++) {
+    long long min_dist;
+    batch_cluster[s] = nearest_centroid(&coords[(size_t)batch[s] * D], centroids, K, D, &min_dist);
+  }
+  for (int s = 0; s < b; s++) {
+    int cluster_id = batch_cluster[s];
+    cluster_counts[cluster_id]++;
+    for (int j = 0; j < D; j++) {
+      cluster_sums[cluster_id * D + j] += coords[(size_t)batch[s] * D + j];
+    }
   }
+  compute_centroids_from_sums(centroids, cluster_sums, cluster_counts, K, D);
+}
 
-  for (int i = 0; i < M; i++) {
+// --- Kernels Especializados por Dimensão ---
+
+/*
+ * D só é conhecido em tempo de execução, então o laço 'for (d = 0; d < D; d++)'
+ * da distância e da soma nos acumuladores não pode ser desenrolado nem manter
+ * os termos em registradores. Com --specialize, o motor baseline usa versões
+ * geradas por DEFINE_DIM_KERNELS para as dimensões mais usadas, em que D é uma
+ * constante de compilação e os laços são totalmente desenrolados; as demais
+ * dimensões usam as versões genéricas. As operações e a ordem de comparação
+ * são as mesmas, então o resultado é idêntico.
+ */
+
+// Centroide mais próximo de 'point' (empate: menor índice), com os centroides em K * D inteiros contíguos
+typedef int (*NearestKernel)(const int* point, const int* centroids, int K, int D, long long* min_dist);
+
+// Soma dos pontos [begin, end) nos acumuladores do seu cluster
+typedef void (*AccumulateKernel)(const int* coords, const Labels* labels, int begin, int end, int D,
+                                 long long* cluster_sums, int* cluster_counts);
+
+typedef struct {
+  NearestKernel nearest;
+  AccumulateKernel accumulate;
+  int dim;  // D da versão especializada (0 = genérica)
+} DimKernels;
+
+/**
+ * @brief Soma as coordenadas dos pontos [begin, end) nos acumuladores do seu cluster.
+ */
+void accumulate_points(const int* coords, const Labels* labels, int begin, int end, int D, long long* cluster_sums,
+                       int* cluster_counts) {
+  for (int i = begin; i < end; i++) {
+    int cluster_id = label_get(labels, i);
+    cluster_counts[cluster_id]++;
     for (int j = 0; j < D; j++) {
-      if (fscanf(file, "%d", &points[i].coords[j]) != 1) {
-        fprintf(stderr, "Erro: Arquivo de dados mal formatado ou incompleto.\n");
-        fclose(file);
-        exit(EXIT_FAILURE);
+      cluster_sums[cluster_id * D + j] += coords[(size_t)i * D + j];
+    }
+  }
+}
+
+// Gera nearest_centroid_d<dim> e accumulate_points_d<dim>, com D fixo em 'dim'
+#define DEFINE_DIM_KERNELS(dim)                                                                                     \
+  int nearest_centroid_d##dim(const int* point, const int* centroids, int K, int D, long long* min_dist) {        \
+    (void)D;                                                                                                       \
+    long long x[dim];                                                                                              \
+    _Pragma("GCC unroll 32") for (int d = 0; d < dim; d++) x[d] = point[d];                                        \
+    int best_cluster = -1;                                                                                         \
+    long long best = LLONG_MAX;                                                                                    \
+    for (int j = 0; j < K; j++) {                                                                                  \
+      const int* c = &centroids[j * dim];                                                                          \
+      long long dist = 0;                                                                                          \
+      _Pragma("GCC unroll 32") for (int d = 0; d < dim; d++) {                                                     \
+        long long diff = x[d] - c[d];                                                                              \
+        dist += diff * diff;                                                                                       \
+      }                                                                                                            \
+      if (dist < best) {                                                                                           \
+        best = dist;                                                                                               \
+        best_cluster = j;                                                                                          \
+      }                                                                                                            \
+    }                                                                                                              \
+    *min_dist = best;                                                                                              \
+    return best_cluster;                                                                                           \
+  }                                                                                                                \
+  void accumulate_points_d##dim(const int* coords, const Labels* labels, int begin, int end, int D,              \
+                                long long* cluster_sums, int* cluster_counts) {                                    \
+    (void)D;                                                                                                       \
+    for (int i = begin; i < end; i++) {                                                                            \
+      int cluster_id = label_get(labels, i);                                                                       \
+      const int* p = &coords[(size_t)i * dim];                                                                     \
+      long long* sums = &cluster_sums[cluster_id * dim];                                                           \
+      cluster_counts[cluster_id]++;                                                                                \
+      _Pragma("GCC unroll 32") for (int d = 0; d < dim; d++) sums[d] += p[d];                                      \
+    }                                                                                                              \
+  }
+
+DEFINE_DIM_KERNELS(2)
+DEFINE_DIM_KERNELS(3)
+DEFINE_DIM_KERNELS(10)
+DEFINE_DIM_KERNELS(16)
+DEFINE_DIM_KERNELS(32)
+
+/**
+ * @brief Escolhe os kernels para D: a versão especializada se houver uma (e
+ * 'specialize' estiver ligado), senão a genérica.
+ */
+DimKernels select_dim_kernels(int D, int specialize) {
+  static const DimKernels table[] = {{nearest_centroid_d2, accumulate_points_d2, 2},
+                                     {nearest_centroid_d3, accumulate_points_d3, 3},
+                                     {nearest_centroid_d10, accumulate_points_d10, 10},
+                                     {nearest_centroid_d16, accumulate_points_d16, 16},
+                                     {nearest_centroid_d32, accumulate_points_d32, 32}};
+  if (specialize) {
+    for (size_t t = 0; t < sizeof(table) / sizeof(table[0]); t++) {
+      if (table[t].dim == D) return table[t];
+    }
+  }
+  DimKernels generic = {nearest_centroid, accumulate_points, 0};
+  return generic;
+}
+
+// --- Motor de Execução das Iterações ---
+
+// Blocos SIMD processados por vez na passada fundida (1024 pontos, cabem em L2)
+#define FUSED_CHUNK_BLOCKS 64
+
+// Pontos por trecho no modo em fluxo quando --stream não informa o tamanho
+#define STREAM_DEFAULT_CHUNK 65536
+
+// Estado de uma execução: dados, motor escolhido e áreas de trabalho alocadas uma única vez
+typedef struct {
+  int* coords;     // Coordenadas dos M pontos, coords[i * D + d] (NULL em fluxo e após --assign=narrow)
+  Labels labels;   // Cluster de cada ponto (M), no menor tipo que comporta K
+  int* centroids;  // Coordenadas dos K centroides, centroids[j * D + d]
+  int M, K, D, I;
+  long long coord_range;  // Amplitude (max - min) das coordenadas do dataset
+  KMeansOptions opts;
+  Arena* arena;  // Origem de todas as áreas de trabalho abaixo (liberadas juntas no final)
+
+  DimKernels dim;                 // Distância e soma do motor baseline (especializadas com --specialize)
+  PointBlocks blocks;             // --assign=simd
+  BlockAssignKernel simd_kernel;  // --assign=simd
+  TileShape tile;                 // --assign=tiled
+  long long* tile_min_dist;       // --assign=tiled
+  int* tile_best_cluster;         // --assign=tiled
+  GemmState gemm;                 // --assign=gemm
+  long long* cluster_sums;        // --fused/--update=delta: somas por cluster (K * D)
+  int* cluster_counts;            // --fused/--update=delta: pontos por cluster (K)
+  long long* update_sums;         // Atualização padrão (update_centroids): somas por cluster (K * D)
+  int* update_counts;             // Atualização padrão (update_centroids): pontos por cluster (K)
+  int* prev_cluster;              // --update=delta/--converge: cluster de cada ponto na iteração anterior (M)
+  long long changed;              // --update=delta/--converge: pontos que mudaram de cluster na última iteração
+  long long* churn;               // --converge: pontos (ou, em fluxo, centroides) que mudaram em cada iteração (I)
+  StreamReader stream;            // --stream: leitor com buffer duplo
+  int* stream_prev_centroids;     // --stream: centroides antes da atualização (K * D)
+  int iterations_run;             // Iterações efetivamente executadas
+  PruneState prune;               // --assign=hamerly|elkan
+  NarrowBlocks narrow;            // --assign=narrow
+  NarrowAssignKernel narrow_kernel;  // --assign=narrow
+  int* centroid_pairs;            // --assign=narrow: centroides em pares de 16 bits (K * pares)
+  Dataset* dataset;               // Dataset int32, liberado por --assign=narrow após montar o layout estreito
+  int* batch;                     // --minibatch: índices do lote da iteração (b)
+  int* batch_cluster;             // --minibatch: cluster de cada ponto do lote (b)
+  long long cost;                 // --final-pass/--cost: soma das distâncias ao quadrado (-1 = não calculada)
+  long long inertia;              // Soma das distâncias mínimas da atribuição da iteração atual
+  long long* inertia_log;         // --metrics: inércia de cada iteração (I)
+  int* empty_log;                 // --metrics: clusters vazios em cada iteração (I)
+  long long* far_dist;            // --empty: maior distância mínima entre os pontos de cada cluster (K)
+  int* far_point;                 // --empty: ponto que a atingiu (K; -1 = nenhum)
+  long long relocated;            // --empty: clusters vazios que receberam um ponto
+} KMeansState;
+
+/**
+ * @brief Atualização incremental: para cada ponto de [begin, end) cujo cluster
+ * mudou desde a iteração anterior, retira suas coordenadas das somas do cluster
+ * antigo e as adiciona às do novo. Na primeira iteração (prev_cluster = -1) todos
+ * os pontos são somados. Como as somas são inteiras, o resultado é exatamente o
+ * mesmo de refazê-las do zero, mas o custo passa a ser proporcional à rotatividade.
+ * @return O número de pontos que mudaram de cluster.
+ */
+long long apply_label_deltas(const int* coords, const Labels* labels, int begin, int end, int D, int* prev_cluster,
+                             long long* cluster_sums, int* cluster_counts) {
+  long long changed = 0;
+  for (int i = begin; i < end; i++) {
+    int old_id = prev_cluster[i];
+    int new_id = label_get(labels, i);
+    if (old_id == new_id) continue;
+
+    changed++;
+    if (old_id >= 0) {
+      cluster_counts[old_id]--;
+      for (int j = 0; j < D; j++) {
+        cluster_sums[old_id * D + j] -= coords[(size_t)i * D + j];
       }
     }
+    cluster_counts[new_id]++;
+    for (int j = 0; j < D; j++) {
+      cluster_sums[new_id * D + j] += coords[(size_t)i * D + j];
+    }
+    prev_cluster[i] = new_id;
   }
+  return changed;
+}
 
-  fclose(file);
+/**
+ * @brief Conta os pontos de [begin, end) que mudaram de cluster e registra o
+ * cluster atual para a próxima comparação.
+ */
+long long count_label_changes(const Labels* labels, int begin, int end, int* prev_cluster) {
+  long long changed = 0;
+  for (int i = begin; i < end; i++) {
+    int cluster_id = label_get(labels, i);
+    if (prev_cluster[i] != cluster_id) {
+      prev_cluster[i] = cluster_id;
+      changed++;
+    }
+  }
+  return changed;
 }
 
 /**
- * @brief Inicializa os centroides escolhendo K pontos aleatórios do dataset.
+ * @brief Versão de accumulate_points que lê as coordenadas do layout em blocos,
+ * ainda presentes na cache logo após o kernel SIMD ter passado por elas.
  */
-void initialize_centroids(Point* points, Point* centroids, int M, int K, int D) {
-  srand(42);  // Semente fixa para reprodutibilidade
+void accumulate_blocks(const PointBlocks* pb, const Labels* labels, int M, int D, int b_begin, int b_end,
+                       long long* cluster_sums, int* cluster_counts) {
+  for (int b = b_begin; b < b_end; b++) {
+    const int* block = &pb->data[(size_t)b * D * SIMD_BLOCK];
+    for (int l = 0; l < SIMD_BLOCK && b * SIMD_BLOCK + l < M; l++) {
+      int cluster_id = label_get(labels, b * SIMD_BLOCK + l);
+      cluster_counts[cluster_id]++;
+      for (int j = 0; j < D; j++) {
+        cluster_sums[cluster_id * D + j] += block[j * SIMD_BLOCK + l];
+      }
+    }
+  }
+}
 
-  int* indices = (int*)malloc(M * sizeof(int));
-  for (int i = 0; i < M; i++) {
-    indices[i] = i;
+/**
+ * @brief Atribuição com poda (Hamerly ou Elkan) dos pontos [begin, end).
+ */
+void assign_points_pruned(KMeansState* st, int begin, int end) {
+  if (st->opts.assign == ASSIGN_ELKAN) {
+    assign_points_elkan(&st->prune, st->coords, st->centroids, &st->labels, st->K, st->D, begin, end);
+  } else {
+    assign_points_hamerly(&st->prune, st->coords, st->centroids, &st->labels, st->K, st->D, begin, end);
   }
+}
 
-  for (int i = 0; i < M; i++) {
-    int j = rand() % M;
-    int temp = indices[i];
-    indices[i] = indices[j];
-    indices[j] = temp;
+int uses_pruning(const KMeansState* st) {
+  return st->opts.assign == ASSIGN_HAMERLY || st->opts.assign == ASSIGN_ELKAN;
+}
+
+/**
+ * @brief Leva os pontos [begin, end), recém-atribuídos, para os acumuladores:
+ * soma completa ou, com --update=delta, só as mudanças de cluster.
+ */
+void accumulate_range(KMeansState* st, int begin, int end) {
+  if (st->opts.delta_update) {
+    st->changed += apply_label_deltas(st->coords, &st->labels, begin, end, st->D, st->prev_cluster, st->cluster_sums,
+                                      st->cluster_counts);
+  } else {
+    st->dim.accumulate(st->coords, &st->labels, begin, end, st->D, st->cluster_sums, st->cluster_counts);
+    if (st->prev_cluster != NULL) st->changed += count_label_changes(&st->labels, begin, end, st->prev_cluster);
   }
+}
 
-  for (int i = 0; i < K; i++) {
-    memcpy(centroids[i].coords, points[indices[i]].coords, D * sizeof(int));
+// --- Clusters Vazios ---
+
+/*
+ * Com --empty=farthest|split, a atribuição registra, para cada cluster, o
+ * ponto mais distante do seu centroide (o custo é uma comparação por ponto,
+ * com a distância mínima que ela já calculou). Antes do cálculo dos
+ * centroides, cada cluster vazio recebe um desses pontos, que sai das somas do
+ * cluster de origem:
+ *  - farthest: o ponto mais distante entre todos os clusters (o pior atendido);
+ *  - split:    o ponto mais distante do maior cluster, que passa a ser dividido
+ *              entre ele e o cluster vazio nas próximas iterações.
+ * Cada cluster doa no máximo um ponto por iteração e só se tiver mais de um;
+ * empates vão para o menor índice, então o resultado é determinístico.
+ */
+
+/**
+ * @brief Atribuição do laço original dos pontos [begin, end) que também soma
+ * a inércia e, com --empty, registra o ponto mais distante de cada cluster.
+ */
+void assign_points_tracked(KMeansState* st, int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    long long min_dist;
+    int best_cluster = st->dim.nearest(&st->coords[(size_t)i * st->D], st->centroids, st->K, st->D, &min_dist);
+    label_set(&st->labels, i, best_cluster);
+    st->inertia += min_dist;
+    if (st->far_dist != NULL && min_dist > st->far_dist[best_cluster]) {
+      st->far_dist[best_cluster] = min_dist;
+      st->far_point[best_cluster] = i;
+    }
   }
+}
 
-  free(indices);
+void reset_farthest(KMeansState* st) {
+  for (int j = 0; j < st->K; j++) {
+    st->far_dist[j] = 0;  // Pontos sobre o próprio centroide nunca são doados
+    st->far_point[j] = -1;
+  }
 }
 
 /**
- * @brief Fase de Atribuição: Associa cada ponto ao cluster do centroide mais próximo.
+ * @brief Aplica a política de clusters vazios às somas e contagens da
+ * iteração, antes de compute_centroids_from_sums.
  */
-void assign_points_to_clusters(Point* points, Point* centroids, int M, int K, int D) {
-  for (int i = 0; i < M; i++) {
-    long long min_dist = LLONG_MAX;
-    int best_cluster = -1;
+void relocate_empty_clusters(KMeansState* st) {
+  int K = st->K, D = st->D;
+  for (int e = 0; e < K; e++) {
+    if (st->cluster_counts[e] > 0) continue;
 
-    for (int j = 0; j < K; j++) {
-      long long dist = euclidean_dist_sq(&points[i], &centroids[j], D);
-      if (dist < min_dist) {
-        min_dist = dist;
-        best_cluster = j;
+    int donor = -1;
+    for (int c = 0; c < K; c++) {
+      if (st->far_point[c] < 0 || st->cluster_counts[c] < 2) continue;
+      if (donor < 0 || (st->opts.empty == EMPTY_FARTHEST ? st->far_dist[c] > st->far_dist[donor]
+                                                         : st->cluster_counts[c] > st->cluster_counts[donor])) {
+        donor = c;
       }
     }
-    points[i].cluster_id = best_cluster;
+    if (donor < 0) break;  // Nenhum cluster pode doar nesta iteração
+
+    const int* point = &st->coords[(size_t)st->far_point[donor] * D];
+    st->cluster_counts[donor]--;
+    st->cluster_counts[e] = 1;
+    for (int j = 0; j < D; j++) {
+      st->cluster_sums[donor * D + j] -= point[j];
+      st->cluster_sums[e * D + j] = point[j];
+    }
+    label_set(&st->labels, st->far_point[donor], e);
+    st->far_point[donor] = -1;
+    st->relocated++;
+    st->changed++;  // Os centroides mudam: a iteração não é um ponto fixo
   }
 }
 
 /**
- * @brief Fase de Atualização: Recalcula a posição de cada centroide como a média
- * (usando divisão inteira) de todos os pontos atribuídos ao seu cluster.
+ * @brief Iteração fundida: cada trecho de pontos é atribuído e, enquanto ainda
+ * está na cache, somado aos acumuladores do seu cluster. Elimina a segunda
+ * varredura de update_centroids e as alocações por iteração; como as somas são
+ * inteiras, o resultado é idêntico ao das duas fases separadas. Com
+ * --update=delta os acumuladores não são zerados: cada trecho só aplica as
+ * mudanças de cluster.
  */
-void update_centroids(Point* points, Point* centroids, int M, int K, int D) {
-  long long* cluster_sums = (long long*)calloc(K * D, sizeof(long long));
-  int* cluster_counts = (int*)calloc(K, sizeof(int));
+void fused_iteration(KMeansState* st) {
+  int M = st->M, K = st->K, D = st->D;
+  if (!st->opts.delta_update) {
+    memset(st->cluster_sums, 0, (size_t)K * D * sizeof(long long));
+    memset(st->cluster_counts, 0, (size_t)K * sizeof(int));
+  }
 
-  for (int i = 0; i < M; i++) {
-    int cluster_id = points[i].cluster_id;
-    cluster_counts[cluster_id]++;
-    for (int j = 0; j < D; j++) {
-      cluster_sums[cluster_id * D + j] += points[i].coords[j];
+  if (uses_pruning(st)) {
+    for (int p0 = 0; p0 < M; p0 += FUSED_CHUNK_BLOCKS * SIMD_BLOCK) {
+      int p1 = p0 + FUSED_CHUNK_BLOCKS * SIMD_BLOCK < M ? p0 + FUSED_CHUNK_BLOCKS * SIMD_BLOCK : M;
+      assign_points_pruned(st, p0, p1);
+      accumulate_range(st, p0, p1);
+    }
+  } else if (st->opts.assign == ASSIGN_SIMD) {
+    for (int b0 = 0; b0 < st->blocks.num_blocks; b0 += FUSED_CHUNK_BLOCKS) {
+      int b1 = b0 + FUSED_CHUNK_BLOCKS < st->blocks.num_blocks ? b0 + FUSED_CHUNK_BLOCKS : st->blocks.num_blocks;
+      st->inertia += st->simd_kernel(&st->blocks, st->centroids, &st->labels, M, K, D, b0, b1);
+      if (st->opts.delta_update) {
+        accumulate_range(st, b0 * SIMD_BLOCK, b1 * SIMD_BLOCK < M ? b1 * SIMD_BLOCK : M);
+      } else {
+        accumulate_blocks(&st->blocks, &st->labels, M, D, b0, b1, st->cluster_sums, st->cluster_counts);
+        if (st->prev_cluster != NULL) {
+          st->changed += count_label_changes(&st->labels, b0 * SIMD_BLOCK, b1 * SIMD_BLOCK < M ? b1 * SIMD_BLOCK : M,
+                                             st->prev_cluster);
+        }
+      }
+    }
+  } else if (st->opts.assign == ASSIGN_NARROW) {
+    pack_centroid_pairs(&st->narrow, st->centroids, K, D, st->centroid_pairs);
+    for (int b0 = 0; b0 < st->narrow.num_blocks; b0 += FUSED_CHUNK_BLOCKS) {
+      int b1 = b0 + FUSED_CHUNK_BLOCKS < st->narrow.num_blocks ? b0 + FUSED_CHUNK_BLOCKS : st->narrow.num_blocks;
+      st->inertia += st->narrow_kernel(&st->narrow, st->centroid_pairs, &st->labels, M, K, b0, b1);
+      accumulate_narrow_blocks(&st->narrow, &st->labels, M, D, b0, b1, st->cluster_sums, st->cluster_counts);
+      if (st->prev_cluster != NULL) {
+        st->changed += count_label_changes(&st->labels, b0 * SIMD_BLOCK, b1 * SIMD_BLOCK < M ? b1 * SIMD_BLOCK : M,
+                                           st->prev_cluster);
+      }
+    }
+  } else if (st->opts.assign == ASSIGN_GEMM) {
+    for (int p0 = 0; p0 < M; p0 += st->gemm.block_points) {
+      int p1 = p0 + st->gemm.block_points < M ? p0 + st->gemm.block_points : M;
+      st->inertia += assign_points_gemm(&st->gemm, st->coords, &st->labels, D, p0, p1);
+      accumulate_range(st, p0, p1);
+    }
+  } else if (st->opts.assign == ASSIGN_TILED) {
+    for (int p0 = 0; p0 < M; p0 += st->tile.points) {
+      int p1 = p0 + st->tile.points < M ? p0 + st->tile.points : M;
+      st->inertia += assign_points_tiled(st->coords, st->centroids, &st->labels, p0, p1, K, D, st->tile,
+                                         st->tile_min_dist, st->tile_best_cluster);
+      accumulate_range(st, p0, p1);
+    }
+  } else {
+    for (int p0 = 0; p0 < M; p0 += FUSED_CHUNK_BLOCKS * SIMD_BLOCK) {
+      int p1 = p0 + FUSED_CHUNK_BLOCKS * SIMD_BLOCK < M ? p0 + FUSED_CHUNK_BLOCKS * SIMD_BLOCK : M;
+      assign_points_tracked(st, p0, p1);
+      accumulate_range(st, p0, p1);
     }
   }
 
-  for (int i = 0; i < K; i++) {
-    if (cluster_counts[i] > 0) {
+  if (st->far_dist != NULL) relocate_empty_clusters(st);
+  compute_centroids_from_sums(st->centroids, st->cluster_sums, st->cluster_counts, K, D);
+}
+
+/**
+ * @brief Iteração do modo em fluxo: os pontos nunca ficam todos em memória. Cada
+ * trecho entregue pela thread leitora é atribuído e somado aos acumuladores
+ * (como na passada fundida) enquanto o próximo trecho é lido. Com as somas
+ * inteiras e a mesma regra de desempate, o resultado é idêntico ao em memória.
+ * Sem rótulo por ponto, a convergência é detectada pelos centroides: se
+ * nenhum se moveu, a próxima iteração repetiria exatamente esta.
+ */
+void stream_iteration(KMeansState* st) {
+  int K = st->K, D = st->D;
+  memset(st->cluster_sums, 0, (size_t)K * D * sizeof(long long));
+  memset(st->cluster_counts, 0, (size_t)K * sizeof(int));
+
+  for (int c = 0; c < st->stream.num_chunks; c++) {
+    int count;
+    const int* chunk = stream_next(&st->stream, &count);
+    for (int i = 0; i < count; i++) {
+      const int* point = &chunk[(size_t)i * D];
+      long long min_dist;
+      int best_cluster = st->dim.nearest(point, st->centroids, K, D, &min_dist);
+      st->inertia += min_dist;
+      st->cluster_counts[best_cluster]++;
       for (int j = 0; j < D; j++) {
-        // Divisão inteira para manter os centroides em coordenadas discretas
-        centroids[i].coords[j] = cluster_sums[i * D + j] / cluster_counts[i];
+        st->cluster_sums[best_cluster * D + j] += point[j];
+      }
+    }
+    stream_release(&st->stream);
+  }
+
+  memcpy(st->stream_prev_centroids, st->centroids, (size_t)K * D * sizeof(int));
+  compute_centroids_from_sums(st->centroids, st->cluster_sums, st->cluster_counts, K, D);
+  st->changed = 0;
+  for (int j = 0; j < K; j++) {
+    st->changed += memcmp(&st->stream_prev_centroids[j * D], &st->centroids[j * D], D * sizeof(int)) != 0;
+  }
+}
+
+/**
+ * @brief Prepara o motor escolhido nas opções (fora da medição de tempo):
+ * layouts auxiliares, ajuste de tiles e acumuladores.
+ */
+void setup_engine(KMeansState* st) {
+  int M = st->M, K = st->K, D = st->D;
+
+  if (st->coords != NULL) {
+    st->labels = labels_wrap(arena_alloc(st->arena, labels_size(M, K)), K);
+  }
+
+  st->dim = select_dim_kernels(D, st->opts.specialize);
+  if (st->opts.specialize) {
+    if (st->dim.dim > 0) {
+      fprintf(stderr, "Kernels de distância/soma: especializados para D=%d\n", D);
+    } else {
+      fprintf(stderr, "Kernels de distância/soma: genéricos (sem versão especializada para D=%d)\n", D);
+    }
+  }
+
+  // Amplitude grande demais para 16 bits: o layout estreito não cabe, e a
+  // passada fundida segue com o kernel SIMD sobre as coordenadas int32
+  if (st->opts.assign == ASSIGN_NARROW &&
+      !choose_narrow_format(st->dataset->min_val, st->dataset->max_val, D, &st->narrow)) {
+    fprintf(stderr, "Aviso: amplitude das coordenadas (%lld) não cabe em 16 bits; usando --assign=simd.\n",
+            st->coord_range);
+    st->opts.assign = ASSIGN_SIMD;
+  }
+
+  if (st->opts.assign == ASSIGN_SIMD) {
+    const char* kernel_name;
+    st->simd_kernel = select_simd_kernel(st->opts.isa, st->coord_range, &kernel_name);
+    st->blocks = build_point_blocks(st->coords, M, D, st->arena);
+    fprintf(stderr, "Kernel de atribuição: %s\n", kernel_name);
+  }
+
+  if (st->opts.assign == ASSIGN_NARROW) {
+    const char* kernel_name;
+    st->narrow_kernel = select_narrow_kernel(st->opts.isa, &st->narrow, &kernel_name);
+    build_narrow_blocks(st->coords, M, D, &st->narrow, st->arena);
+    st->centroid_pairs = (int*)arena_alloc(st->arena, (size_t)K * st->narrow.pairs * sizeof(int));
+
+    // Os pontos int32 não são mais lidos: libera-os para que a economia de memória seja real
+    double before_mb = (double)M * D * sizeof(int) / (1024.0 * 1024.0);
+    double after_mb = (double)st->narrow.num_blocks * st->narrow.pairs * 2 * SIMD_BLOCK * st->narrow.elem_bytes /
+                      (1024.0 * 1024.0);
+    free_dataset(st->dataset);
+    st->coords = NULL;
+    fprintf(stderr, "Kernel de atribuição: %s\n", kernel_name);
+    fprintf(stderr, "Armazenamento: int%d (base %d), acumulador de %d bits, pontos: %.1f MB -> %.1f MB\n",
+            8 * st->narrow.elem_bytes, st->narrow.base, st->narrow.wide_acc ? 64 : 32, before_mb, after_mb);
+  }
+
+  if (st->opts.assign == ASSIGN_TILED) {
+    st->tile = st->opts.tile;
+    if (st->tile.points == 0) st->tile = autotune_tiles(st->coords, st->centroids, &st->labels, M, K, D, st->arena);
+    if (st->tile.points > M) st->tile.points = M;
+    if (st->tile.centroids > K) st->tile.centroids = K;
+    st->tile_min_dist = (long long*)arena_alloc(st->arena, st->tile.points * sizeof(long long));
+    st->tile_best_cluster = (int*)arena_alloc(st->arena, st->tile.points * sizeof(int));
+    fprintf(stderr, "Tile de atribuição: %d pontos x %d centroides\n", st->tile.points, st->tile.centroids);
+  }
+
+  if (st->opts.assign == ASSIGN_GEMM) {
+    const char* kernel_name;
+    gemm_setup(&st->gemm, st->opts.isa, st->coords, M, K, D, st->arena, &kernel_name);
+    fprintf(stderr, "Kernel de atribuição: %s (%d pontos x %d centroides por microtile, blocos de %d x %d)\n",
+            kernel_name, GEMM_MR, st->gemm.panel, st->gemm.block_points, st->gemm.block_panels * st->gemm.panel);
+  }
+
+  if (uses_pruning(st)) {
+    prune_alloc(&st->prune, st->opts.assign, M, K, D, st->arena);
+  }
+
+  if (st->opts.stream_chunk > 0) {
+    st->stream_prev_centroids = (int*)arena_alloc(st->arena, (size_t)K * D * sizeof(int));
+    stream_start(&st->stream, st->I);
+  }
+
+  if (st->opts.batch_size > 0) {
+    st->batch = (int*)arena_alloc(st->arena, (size_t)st->opts.batch_size * sizeof(int));
+    st->batch_cluster = (int*)arena_alloc(st->arena, (size_t)st->opts.batch_size * sizeof(int));
+  }
+
+  if (st->opts.fused || st->opts.delta_update || st->opts.stream_chunk > 0 || st->opts.batch_size > 0 ||
+      st->opts.metrics != METRICS_NONE || st->opts.empty != EMPTY_KEEP || st->opts.specialize) {
+    st->cluster_sums = (long long*)arena_alloc(st->arena, (size_t)K * D * sizeof(long long));
+    st->cluster_counts = (int*)arena_alloc(st->arena, (size_t)K * sizeof(int));
+  } else {
+    st->update_sums = (long long*)arena_alloc(st->arena, (size_t)K * D * sizeof(long long));
+    st->update_counts = (int*)arena_alloc(st->arena, (size_t)K * sizeof(int));
+  }
+
+  if (st->opts.delta_update ||
+      ((st->opts.converge || st->opts.metrics != METRICS_NONE) && st->opts.stream_chunk == 0)) {
+    st->prev_cluster = (int*)arena_alloc(st->arena, (size_t)M * sizeof(int));
+    for (int i = 0; i < M; i++) {
+      st->prev_cluster[i] = -1;
+    }
+  }
+
+  if (st->opts.converge || st->opts.metrics != METRICS_NONE) {
+    st->churn = (long long*)arena_alloc(st->arena, st->I * sizeof(long long));
+  }
+
+  if (st->opts.empty != EMPTY_KEEP) {
+    st->far_dist = (long long*)arena_alloc(st->arena, (size_t)K * sizeof(long long));
+    st->far_point = (int*)arena_alloc(st->arena, (size_t)K * sizeof(int));
+  }
+
+  if (st->opts.metrics != METRICS_NONE) {
+    st->inertia_log = (long long*)arena_alloc(st->arena, st->I * sizeof(long long));
+    st->empty_log = (int*)arena_alloc(st->arena, st->I * sizeof(int));
+  }
+}
+
+// --- Métricas de Qualidade ---
+
+/*
+ * Com --metrics, cada iteração registra a inércia (soma das distâncias mínimas
+ * que a atribuição já calcula, em relação aos centroides usados nela), a
+ * rotatividade (pontos que mudaram de cluster; em fluxo, centroides que se
+ * moveram) e o número de clusters vazios (das contagens da atualização). Os
+ * motores com poda (Hamerly/Elkan) só guardam limites para a maioria dos
+ * pontos, não a distância exata, então com eles a inércia não é informada.
+ */
+
+int inertia_available(const KMeansState* st) {
+  return !uses_pruning(st);
+}
+
+/**
+ * @brief Fecha a iteração: guarda a rotatividade e, com --metrics, a inércia e
+ * os clusters vazios.
+ */
+void record_iteration(KMeansState* st) {
+  int iter = st->iterations_run;
+  if (st->churn != NULL) st->churn[iter] = st->changed;
+  if (st->inertia_log != NULL) {
+    int empty = 0;
+    for (int j = 0; j < st->K; j++) {
+      empty += st->cluster_counts[j] == 0;
+    }
+    st->inertia_log[iter] = st->inertia;
+    st->empty_log[iter] = empty;
+  }
+  st->iterations_run++;
+}
+
+/**
+ * @brief Imprime as métricas em stdout, depois do tempo e do checksum (o
+ * avaliador só lê as duas primeiras linhas). Os tamanhos dos clusters são os
+ * da última atribuição.
+ */
+void print_metrics(const KMeansState* st) {
+  int last = st->iterations_run - 1;
+  int has_inertia = inertia_available(st);
+
+  if (st->opts.metrics == METRICS_JSON) {
+    printf("{\"iterations\":%d,\"inertia\":", st->iterations_run);
+    if (has_inertia && last >= 0) {
+      printf("%lld", st->inertia_log[last]);
+    } else {
+      printf("null");
+    }
+    printf(",\"empty_clusters\":%d,\"cost\":", last >= 0 ? st->empty_log[last] : 0);
+    if (st->cost >= 0) {
+      printf("%lld", st->cost);
+    } else {
+      printf("null");
+    }
+    printf(",\"cluster_sizes\":[");
+    for (int j = 0; j < st->K; j++) {
+      printf("%s%d", j > 0 ? "," : "", st->cluster_counts[j]);
+    }
+    printf("],\"history\":[");
+    for (int iter = 0; iter <= last; iter++) {
+      printf("%s{\"iteration\":%d,\"inertia\":", iter > 0 ? "," : "", iter + 1);
+      if (has_inertia) {
+        printf("%lld", st->inertia_log[iter]);
+      } else {
+        printf("null");
       }
+      printf(",\"churn\":%lld,\"empty_clusters\":%d}", st->churn[iter], st->empty_log[iter]);
+    }
+    printf("]}\n");
+    return;
+  }
+
+  printf("iteration,inertia,churn,empty_clusters\n");
+  for (int iter = 0; iter <= last; iter++) {
+    printf("%d,", iter + 1);
+    if (has_inertia) printf("%lld", st->inertia_log[iter]);
+    printf(",%lld,%d\n", st->churn[iter], st->empty_log[iter]);
+  }
+  printf("\ncluster,size\n");
+  for (int j = 0; j < st->K; j++) {
+    printf("%d,%d\n", j, st->cluster_counts[j]);
+  }
+}
+
+/**
+ * @brief Executa uma iteração completa (atribuição + atualização) com o motor escolhido.
+ */
+void run_iteration(KMeansState* st) {
+  st->changed = 0;
+  st->inertia = 0;
+  if (st->opts.batch_size > 0) {
+    sample_batch(st->batch, st->opts.batch_size, st->M, st->opts.seed, st->iterations_run);
+    minibatch_step(st->coords, st->centroids, st->batch, st->batch_cluster, st->opts.batch_size, st->K, st->D,
+                   st->cluster_sums, st->cluster_counts);
+    st->iterations_run++;
+    return;
+  }
+  if (st->opts.stream_chunk > 0) {
+    stream_iteration(st);
+    record_iteration(st);
+    return;
+  }
+  if (uses_pruning(st)) {
+    prune_begin_iteration(&st->prune, &st->labels, st->centroids, st->M, st->K, st->D);
+  }
+  if (st->far_dist != NULL) reset_farthest(st);
+  if (st->opts.assign == ASSIGN_GEMM) gemm_pack_centroids(&st->gemm, st->centroids, st->K, st->D);
+
+  if (st->opts.fused) {
+    fused_iteration(st);
+  } else {
+    if (uses_pruning(st)) {
+      assign_points_pruned(st, 0, st->M);
+    } else if (st->opts.assign == ASSIGN_SIMD) {
+      st->inertia =
+          st->simd_kernel(&st->blocks, st->centroids, &st->labels, st->M, st->K, st->D, 0, st->blocks.num_blocks);
+    } else if (st->opts.assign == ASSIGN_GEMM) {
+      st->inertia = assign_points_gemm(&st->gemm, st->coords, &st->labels, st->D, 0, st->M);
+    } else if (st->opts.assign == ASSIGN_TILED) {
+      st->inertia = assign_points_tiled(st->coords, st->centroids, &st->labels, 0, st->M, st->K, st->D, st->tile,
+                                        st->tile_min_dist, st->tile_best_cluster);
+    } else if (st->cluster_sums != NULL) {
+      assign_points_tracked(st, 0, st->M);
+    } else {
+      assign_points_to_clusters(st->coords, st->centroids, &st->labels, st->M, st->K, st->D);
+    }
+    if (st->opts.delta_update) {
+      accumulate_range(st, 0, st->M);
+      compute_centroids_from_sums(st->centroids, st->cluster_sums, st->cluster_counts, st->K, st->D);
+    } else if (st->cluster_sums != NULL) {
+      // Mesmo cálculo de update_centroids, nos acumuladores persistentes (--metrics, --empty, --specialize)
+      memset(st->cluster_sums, 0, (size_t)st->K * st->D * sizeof(long long));
+      memset(st->cluster_counts, 0, (size_t)st->K * sizeof(int));
+      accumulate_range(st, 0, st->M);
+      if (st->far_dist != NULL) relocate_empty_clusters(st);
+      compute_centroids_from_sums(st->centroids, st->cluster_sums, st->cluster_counts, st->K, st->D);
+    } else {
+      if (st->prev_cluster != NULL) st->changed = count_label_changes(&st->labels, 0, st->M, st->prev_cluster);
+      update_centroids(st->coords, &st->labels, st->centroids, st->M, st->K, st->D, st->update_sums,
+                       st->update_counts);
+    }
+  }
+
+  if (uses_pruning(st)) prune_end_iteration(&st->prune);
+  record_iteration(st);
+}
+
+/**
+ * @brief Critério de parada do modo --converge. Se nenhum ponto mudou de
+ * cluster, a atualização acabou de recalcular os centroides a partir das mesmas
+ * atribuições da iteração anterior, ou seja, eles não mudam mais: parar aqui
+ * dá o mesmo resultado (e checksum) que executar todas as I iterações. Com
+ * tolerância > 0 a parada é aproximada.
+ */
+int has_converged(const KMeansState* st) {
+  if (!st->opts.converge) return 0;
+  if (st->opts.converge_tol == 0.0) return st->changed == 0;
+  return st->changed <= st->opts.converge_tol * st->M;
+}
+
+/**
+ * @brief Conclui a execução: no modo mini-batch com --final-pass, atribui todos
+ * os pontos aos centroides finais (dentro da medição de tempo), obtendo o
+ * custo de graça.
+ */
+void finish_run(KMeansState* st) {
+  if (st->opts.final_pass) {
+    st->cost = assign_points_with_cost(st->coords, st->centroids, &st->labels, st->M, st->K, st->D);
+  }
+}
+
+/**
+ * @brief Relata em stderr as estatísticas do motor (stdout fica reservado ao avaliador).
+ */
+void print_engine_stats(const KMeansState* st) {
+  if (st->opts.batch_size > 0) {
+    long long visited = (long long)st->opts.batch_size * st->iterations_run;
+    fprintf(stderr, "Mini-batch: %d iterações de %d pontos (%lld pontos visitados = %.2f passadas completas)\n",
+            st->iterations_run, st->opts.batch_size, visited, (double)visited / st->M);
+  }
+  if (st->cost >= 0) {
+    fprintf(stderr, "Custo (soma das distâncias ao quadrado): %lld\n", st->cost);
+  }
+  if (st->opts.converge) {
+    for (int iter = 0; iter < st->iterations_run; iter++) {
+      fprintf(stderr, "Iteração %d: %lld %s\n", iter + 1, st->churn[iter],
+              st->opts.stream_chunk > 0 ? "centroides se moveram" : "pontos mudaram de cluster");
     }
+    fprintf(stderr, "Iterações executadas: %d de %d\n", st->iterations_run, st->I);
+  }
+  if (st->opts.empty != EMPTY_KEEP) {
+    fprintf(stderr, "Clusters vazios que receberam um ponto (--empty=%s): %lld\n",
+            st->opts.empty == EMPTY_FARTHEST ? "farthest" : "split", st->relocated);
+  }
+  if (uses_pruning(st)) {
+    long long total = st->prune.computed + st->prune.skipped;
+    fprintf(stderr, "Distâncias ponto-centroide: %lld calculadas, %lld evitadas (%.1f%% de %lld)\n",
+            st->prune.computed, st->prune.skipped, total > 0 ? 100.0 * st->prune.skipped / total : 0.0, total);
   }
+}
 
-  free(cluster_sums);
-  free(cluster_counts);
+/**
+ * @brief Encerra o motor. As áreas de trabalho de setup_engine estão na arena,
+ * liberada em main; só o leitor em fluxo tem recursos próprios.
+ */
+void free_engine(KMeansState* st) {
+  if (st->opts.stream_chunk > 0) stream_close(&st->stream);
 }
 
 /**
  * @brief Imprime os resultados finais e o checksum (como long long).
  */
-void print_results(Point* centroids, int K, int D) {
+void print_results(const int* centroids, int K, int D) {
   printf("--- Centroides Finais ---\n");
   long long checksum = 0;
   for (int i = 0; i < K; i++) {
     printf("Centroide %d: [", i);
     for (int j = 0; j < D; j++) {
-      printf("%d", centroids[i].coords[j]);
+      printf("%d", centroids[i * D + j]);
       if (j < D - 1) printf(", ");
-      checksum += centroids[i].coords[j];
+      checksum += centroids[i * D + j];
     }
     printf("]\n");
   }
@@ -150,11 +2270,11 @@ void print_results(Point* centroids, int K, int D) {
  * Linha 1: Tempo de execução em segundos (double)
  * Linha 2: Checksum final (long long)
  */
-void print_time_and_checksum(Point* centroids, int K, int D, double exec_time) {
+void print_time_and_checksum(const int* centroids, int K, int D, double exec_time) {
   long long checksum = 0;
   for (int i = 0; i < K; i++) {
     for (int j = 0; j < D; j++) {
-      checksum += centroids[i].coords[j];
+      checksum += centroids[i * D + j];
     }
   }
   // Saída formatada para o avaliador
@@ -162,12 +2282,201 @@ void print_time_and_checksum(Point* centroids, int K, int D, double exec_time) {
   printf("%lld\n", checksum);
 }
 
+/**
+ * @brief Lê as opções extras (formato --nome=valor) que seguem os argumentos obrigatórios.
+ * @return 1 em caso de sucesso, 0 se alguma opção for inválida.
+ */
+int parse_options(int argc, char* argv[], int first, KMeansOptions* opts) {
+  opts->assign = ASSIGN_BASELINE;
+  opts->isa = "auto";
+  opts->tile.points = 0;
+  opts->tile.centroids = 0;
+  opts->fused = 0;
+  opts->delta_update = 0;
+  opts->converge = 0;
+  opts->converge_tol = 0.0;
+  opts->stream_chunk = 0;
+  opts->init = INIT_RANDOM;
+  opts->batch_size = 0;
+  opts->final_pass = 0;
+  opts->seed = INIT_SEED;
+  opts->report_cost = 0;
+  opts->metrics = METRICS_NONE;
+  opts->empty = EMPTY_KEEP;
+  opts->specialize = 0;
+  opts->huge_pages = 1;
+
+  for (int i = first; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "--assign=baseline") == 0) {
+      opts->assign = ASSIGN_BASELINE;
+    } else if (strcmp(arg, "--assign=simd") == 0) {
+      opts->assign = ASSIGN_SIMD;
+    } else if (strcmp(arg, "--assign=tiled") == 0) {
+      opts->assign = ASSIGN_TILED;
+    } else if (strcmp(arg, "--assign=hamerly") == 0) {
+      opts->assign = ASSIGN_HAMERLY;
+    } else if (strcmp(arg, "--assign=elkan") == 0) {
+      opts->assign = ASSIGN_ELKAN;
+    } else if (strcmp(arg, "--assign=narrow") == 0) {
+      opts->assign = ASSIGN_NARROW;
+    } else if (strcmp(arg, "--assign=gemm") == 0) {
+      opts->assign = ASSIGN_GEMM;
+    } else if (strcmp(arg, "--fused") == 0) {
+      opts->fused = 1;
+    } else if (strcmp(arg, "--update=full") == 0) {
+      opts->delta_update = 0;
+    } else if (strcmp(arg, "--update=delta") == 0) {
+      opts->delta_update = 1;
+    } else if (strcmp(arg, "--converge") == 0) {
+      opts->converge = 1;
+      opts->converge_tol = 0.0;
+    } else if (strncmp(arg, "--converge=", 11) == 0) {
+      char* end;
+      opts->converge = 1;
+      opts->converge_tol = strtod(arg + 11, &end);
+      if (end == arg + 11 || *end != '\0' || opts->converge_tol < 0.0 || opts->converge_tol >= 1.0) {
+        fprintf(stderr, "Erro: Tolerância de convergência inválida '%s'.\n", arg + 11);
+        return 0;
+      }
+    } else if (strcmp(arg, "--stream") == 0) {
+      opts->stream_chunk = STREAM_DEFAULT_CHUNK;
+    } else if (strncmp(arg, "--stream=", 9) == 0) {
+      opts->stream_chunk = atoi(arg + 9);
+      if (opts->stream_chunk <= 0) {
+        fprintf(stderr, "Erro: Tamanho de trecho inválido '%s'.\n", arg + 9);
+        return 0;
+      }
+    } else if (strncmp(arg, "--init=", 7) == 0 && init_parse(arg + 7, &opts->init)) {
+      // estratégia de inicialização reconhecida
+    } else if (strncmp(arg, "--minibatch=", 12) == 0) {
+      opts->batch_size = atoi(arg + 12);
+      if (opts->batch_size <= 0) {
+        fprintf(stderr, "Erro: Tamanho de lote inválido '%s'.\n", arg + 12);
+        return 0;
+      }
+    } else if (strcmp(arg, "--final-pass") == 0) {
+      opts->final_pass = 1;
+    } else if (strncmp(arg, "--seed=", 7) == 0) {
+      char* end;
+      opts->seed = strtoull(arg + 7, &end, 10);
+      if (end == arg + 7 || *end != '\0') {
+        fprintf(stderr, "Erro: Semente inválida '%s'.\n", arg + 7);
+        return 0;
+      }
+    } else if (strcmp(arg, "--cost") == 0) {
+      opts->report_cost = 1;
+    } else if (strcmp(arg, "--empty=keep") == 0) {
+      opts->empty = EMPTY_KEEP;
+    } else if (strcmp(arg, "--empty=farthest") == 0) {
+      opts->empty = EMPTY_FARTHEST;
+    } else if (strcmp(arg, "--empty=split") == 0) {
+      opts->empty = EMPTY_SPLIT;
+    } else if (strcmp(arg, "--specialize") == 0) {
+      opts->specialize = 1;
+    } else if (strcmp(arg, "--pages=huge") == 0) {
+      opts->huge_pages = 1;
+    } else if (strcmp(arg, "--pages=normal") == 0) {
+      opts->huge_pages = 0;
+    } else if (strcmp(arg, "--metrics=json") == 0) {
+      opts->metrics = METRICS_JSON;
+    } else if (strcmp(arg, "--metrics=csv") == 0) {
+      opts->metrics = METRICS_CSV;
+    } else if (strcmp(arg, "--tile=auto") == 0) {
+      opts->tile.points = 0;
+      opts->tile.centroids = 0;
+    } else if (sscanf(arg, "--tile=%dx%d", &opts->tile.points, &opts->tile.centroids) == 2 &&
+               opts->tile.points > 0 && opts->tile.centroids > 0) {
+      // tile fixo informado como <pontos>x<centroides>
+    } else if (strncmp(arg, "--isa=", 6) == 0 &&
+               (strcmp(arg + 6, "auto") == 0 || strcmp(arg + 6, "avx512") == 0 || strcmp(arg + 6, "avx2") == 0 ||
+                strcmp(arg + 6, "scalar") == 0)) {
+      opts->isa = arg + 6;
+    } else {
+      fprintf(stderr, "Erro: Opção desconhecida ou inválida '%s'.\n", arg);
+      return 0;
+    }
+  }
+
+  // Sem o dataset em memória não há rótulo por ponto nem layouts auxiliares
+  if (opts->stream_chunk > 0 && (opts->assign != ASSIGN_BASELINE || opts->delta_update ||
+                                  (opts->converge && opts->converge_tol > 0.0) || opts->init != INIT_RANDOM)) {
+    fprintf(stderr,
+            "Erro: --stream só combina com --assign=baseline, --update=full, --converge exato e --init=random.\n");
+    return 0;
+  }
+
+  // O mini-batch sorteia pontos avulsos: só o laço ponto a ponto se aplica
+  if (opts->batch_size > 0 && (opts->assign != ASSIGN_BASELINE || opts->fused || opts->delta_update ||
+                               opts->converge || opts->stream_chunk > 0)) {
+    fprintf(stderr, "Erro: --minibatch não combina com --assign, --fused, --update=delta, --converge nem --stream.\n");
+    return 0;
+  }
+  if (opts->metrics != METRICS_NONE && opts->batch_size > 0) {
+    fprintf(stderr, "Erro: --metrics não combina com --minibatch (use --cost).\n");
+    return 0;
+  }
+  // Só o laço ponto a ponto calcula a distância mínima que escolhe o ponto doado
+  if (opts->empty != EMPTY_KEEP && (opts->assign != ASSIGN_BASELINE || opts->delta_update ||
+                                    opts->stream_chunk > 0 || opts->batch_size > 0)) {
+    fprintf(stderr, "Erro: --empty=farthest|split exige --assign=baseline, sem --update=delta, --stream ou "
+                    "--minibatch.\n");
+    return 0;
+  }
+  // Os kernels especializados substituem o laço ponto a ponto do motor baseline
+  if (opts->specialize && (opts->assign != ASSIGN_BASELINE || opts->batch_size > 0)) {
+    fprintf(stderr, "Erro: --specialize exige --assign=baseline, sem --minibatch.\n");
+    return 0;
+  }
+  if (opts->final_pass && opts->batch_size == 0) {
+    fprintf(stderr, "Erro: --final-pass só vale com --minibatch.\n");
+    return 0;
+  }
+
+  // O custo é calculado sobre as coordenadas int32 em memória
+  if (opts->report_cost && (opts->assign == ASSIGN_NARROW || opts->stream_chunk > 0)) {
+    fprintf(stderr, "Erro: --cost não combina com --assign=narrow nem --stream.\n");
+    return 0;
+  }
+
+  // O layout estreito substitui as coordenadas int32, então só a passada fundida o lê
+  if (opts->assign == ASSIGN_NARROW) {
+    if (opts->delta_update) {
+      fprintf(stderr, "Erro: --assign=narrow não combina com --update=delta.\n");
+      return 0;
+    }
+    opts->fused = 1;
+  }
+  return 1;
+}
+
 // --- Função Principal ---
 
 int main(int argc, char* argv[]) {
   // Validação e leitura dos argumentos de linha de comando
-  if (argc != 6) {
-    fprintf(stderr, "Uso: %s <arquivo_dados> <M_pontos> <D_dimensoes> <K_clusters> <I_iteracoes>\n", argv[0]);
+  KMeansOptions opts;
+  if (argc < 6 || !parse_options(argc, argv, 6, &opts)) {
+    fprintf(stderr, "Uso: %s <arquivo_dados> <M_pontos> <D_dimensoes> <K_clusters> <I_iteracoes> [opções]\n", argv[0]);
+    fprintf(stderr, "Opções:\n");
+    fprintf(stderr, "  --assign=<motor>                Motor da fase de atribuição: baseline (padrão), simd,\n");
+    fprintf(stderr, "                                  tiled, hamerly, elkan, narrow ou gemm\n");
+    fprintf(stderr, "  --isa=auto|avx512|avx2|scalar   Kernel de --assign=simd|narrow|gemm (padrão: auto)\n");
+    fprintf(stderr, "  --tile=auto|<pontos>x<centr>    Tile usado por --assign=tiled (padrão: auto)\n");
+    fprintf(stderr, "  --fused                         Atribuição + atualização em uma única passada\n");
+    fprintf(stderr, "  --update=full|delta             Refaz as somas (padrão) ou aplica só as mudanças\n");
+    fprintf(stderr, "  --converge[=<fração>]           Para quando nenhum ponto (ou menos que fração*M) muda\n");
+    fprintf(stderr, "  --stream[=<pontos>]             Lê um .kmb em trechos a cada iteração (out-of-core)\n");
+    fprintf(stderr, "  --init=random|kmeans++|kmeans|| Centroides iniciais (padrão: random, o sorteio original)\n");
+    fprintf(stderr, "  --minibatch=<b>                 Cada iteração usa b pontos sorteados (mini-batch)\n");
+    fprintf(stderr, "  --final-pass                    Mini-batch: atribui todos os pontos ao final\n");
+    fprintf(stderr, "  --seed=<n>                      Semente do sorteio dos lotes (padrão: %d)\n", INIT_SEED);
+    fprintf(stderr, "  --cost                          Relata a soma das distâncias ao quadrado em stderr\n");
+    fprintf(stderr, "  --empty=keep|farthest|split     Clusters vazios: mantém o centroide (padrão) ou recebem o\n");
+    fprintf(stderr, "                                  ponto mais distante (de todos ou do maior cluster)\n");
+    fprintf(stderr, "  --specialize                    Baseline com kernels de D fixo (D = 2, 3, 10, 16, 32)\n");
+    fprintf(stderr, "  --metrics=json|csv              Inércia, rotatividade, clusters vazios e tamanhos em stdout,\n");
+    fprintf(stderr, "                                  após o tempo e o checksum\n");
+    fprintf(stderr, "  --pages=huge|normal             Páginas da arena de memória (padrão: huge, se disponíveis)\n");
     return EXIT_FAILURE;
   }
 
@@ -183,20 +2492,47 @@ int main(int argc, char* argv[]) {
   }
 
   // --- Alocação de Memória ---
-  int* all_coords = (int*)malloc((M + K) * D * sizeof(int));
-  Point* points = (Point*)malloc(M * sizeof(Point));
-  Point* centroids = (Point*)malloc(K * sizeof(Point));
-  // ... (verificação de alocação) ...
-  for (int i = 0; i < M; i++) {
-    points[i].coords = &all_coords[i * D];
-  }
-  for (int i = 0; i < K; i++) {
-    centroids[i].coords = &all_coords[(M + i) * D];
-  }
+  // Todos os buffers vêm da arena, reservada aqui e em setup_engine; o laço
+  // principal não faz nenhuma alocação no heap
+  Arena arena;
+  arena_init(&arena, opts.huge_pages);
+  Dataset dataset = {0};
+  KMeansState state = {0};
+  int* centroids = (int*)arena_alloc(&arena, (size_t)K * D * sizeof(int));
 
   // --- Preparação (Fora da medição de tempo) ---
-  read_data_from_file(filename, points, M, D);
-  initialize_centroids(points, centroids, M, K, D);
+  if (opts.stream_chunk > 0) {
+    // Modo em fluxo: só centroides, acumuladores e dois buffers de trecho ficam em memória
+    stream_open(&state.stream, filename, M, D, opts.stream_chunk);
+    initialize_centroids_streamed(&state.stream, centroids, M, K, D);
+  } else {
+    // Arquivos .kmb são usados no mapeamento, sem cópia; arquivos texto são convertidos em paralelo direto na arena
+    if (kmb_is_binary(filename)) {
+      load_dataset(filename, M, D, &dataset);
+      dataset_advise_pages(&dataset, opts.huge_pages);
+    } else {
+      load_dataset_into(filename, M, D, &dataset, (int*)arena_alloc(&arena, (size_t)M * D * sizeof(int)));
+    }
+    if (opts.init == INIT_RANDOM) {
+      initialize_centroids(dataset.coords, centroids, M, K, D);
+    } else {
+      init_centers(opts.init, dataset.coords, M, D, K, centroids);
+    }
+  }
+
+  state.coords = dataset.coords;
+  state.centroids = centroids;
+  state.M = M;
+  state.K = K;
+  state.D = D;
+  state.I = I;
+  state.coord_range = (long long)dataset.max_val - dataset.min_val;
+  state.opts = opts;
+  state.dataset = &dataset;
+  state.arena = &arena;
+  state.cost = -1;
+  setup_engine(&state);
+  arena_report(&arena);
 
   // --- Medição de Tempo do Algoritmo Principal ---
   struct timespec start, end;
@@ -204,9 +2540,10 @@ int main(int argc, char* argv[]) {
 
   // Laço principal do K-Means (A única parte que será medida)
   for (int iter = 0; iter < I; iter++) {
-    assign_points_to_clusters(points, centroids, M, K, D);
-    update_centroids(points, centroids, M, K, D);
+    run_iteration(&state);
+    if (has_converged(&state)) break;
   }
+  finish_run(&state);
 
   clock_gettime(CLOCK_MONOTONIC, &end);  // Para o cronômetro
 
@@ -215,11 +2552,16 @@ int main(int argc, char* argv[]) {
 
   // --- Apresentação dos Resultados ---
   print_time_and_checksum(centroids, K, D, time_taken);
+  if (opts.report_cost && state.cost < 0) {
+    state.cost = assign_points_with_cost(state.coords, centroids, &state.labels, M, K, D);  // Fora da medição de tempo
+  }
+  print_engine_stats(&state);
+  if (opts.metrics != METRICS_NONE) print_metrics(&state);
 
   // --- Limpeza ---
-  free(all_coords);
-  free(points);
-  free(centroids);
+  if (dataset.coords != NULL) free_dataset(&dataset);
+  free_engine(&state);
+  arena_release(&arena);
 
   return EXIT_SUCCESS;
 }
\ No newline at end of file